@@ -0,0 +1,741 @@
+#include "contraction_hierarchy.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+namespace graph
+{
+    namespace
+    {
+        const double INFINITE_WEIGHT = std::numeric_limits<double>::infinity();
+        const VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+
+        // a witness search gives up after settling this many vertices; giving up early
+        // only costs an extra shortcut. Priorities are estimated with shorter searches
+        const size_t WITNESS_SETTLE_LIMIT = 500;
+        const size_t ESTIMATE_SETTLE_LIMIT = 50;
+
+        const char MAGIC[8] = {'T', 'C', 'C', 'H', '\0', '\0', '\0', '\0'};
+        const uint32_t VERSION = 1;
+        const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order;
+            uint64_t vertex_count;
+            uint64_t edge_count;
+            // of the graph the hierarchy was built for
+            uint64_t fingerprint;
+            uint64_t shortcut_count;
+            uint64_t up_arc_count;
+            uint64_t down_arc_count;
+            // FNV-1a over everything after the header
+            uint64_t checksum;
+        };
+
+        class Fnv1a
+        {
+        public:
+            void Add(const void* data, size_t size)
+            {
+                const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+                for(size_t i = 0; i < size; i++)
+                {
+                    hash_ ^= bytes[i];
+                    hash_ *= 1099511628211ull;
+                }
+            }
+
+            uint64_t Get() const
+            {
+                return hash_;
+            }
+
+        private:
+            uint64_t hash_ = 14695981039346656037ull;
+        };
+
+        using HeapEntry = std::pair<double, VertexId>;
+
+        // Builds the hierarchy on adjacency lists that grow with the shortcuts and lose the
+        // arcs of every contracted vertex, so they only ever join vertices still to contract.
+        // Vertices are taken in order of twice the edge difference (shortcuts added minus arcs
+        // removed) plus the number of already contracted neighbours and the vertex's level,
+        // one above the highest contracted neighbour; the last two spread contraction evenly
+        // and keep the hierarchy shallow. A priority is recomputed when it reaches the top of
+        // the queue
+        class Contractor
+        {
+        public:
+            struct BuildArc
+            {
+                VertexId other;
+                double weight;
+                EdgeId id;
+            };
+
+            explicit Contractor(const DirectedWeightedGraph<double>& graph) 
+                : edge_count_(graph.GetEdgeCount()), 
+                  out_(graph.GetVertexCount()), 
+                  in_(graph.GetVertexCount()), 
+                  up_(graph.GetVertexCount()), 
+                  down_(graph.GetVertexCount()), 
+                  contracted_neighbors_(graph.GetVertexCount(), 0), 
+                  levels_(graph.GetVertexCount(), 0), 
+                  witness_distances_(graph.GetVertexCount(), INFINITE_WEIGHT), 
+                  is_target_(graph.GetVertexCount(), false)
+            {
+                for(EdgeId id = 0; id < graph.GetEdgeCount(); id++)
+                {
+                    const Edge<double>& edge = graph.GetEdge(id);
+
+                    if(edge.from != edge.to)
+                    {
+                        AddArc(edge.from, edge.to, edge.weight, id);
+                    }
+                }
+            }
+
+            void Run()
+            {
+                std::priority_queue<std::pair<int, VertexId>, std::vector<std::pair<int, VertexId>>, std::greater<>> queue;
+
+                for(VertexId v = 0; v < out_.size(); v++)
+                {
+                    queue.emplace(Priority(v), v);
+                }
+
+                while(!queue.empty())
+                {
+                    VertexId v = queue.top().second;
+                    queue.pop();
+
+                    int priority = Priority(v);
+
+                    if(!queue.empty() && priority > queue.top().first)
+                    {
+                        queue.emplace(priority, v);
+                        continue;
+                    }
+
+                    Contract(v);
+                }
+            }
+
+            // arcs from v to vertices contracted after it
+            const std::vector<std::vector<BuildArc>>& GetUpArcs() const
+            {
+                return up_;
+            }
+
+            // arcs into v from vertices contracted after it
+            const std::vector<std::vector<BuildArc>>& GetDownArcs() const
+            {
+                return down_;
+            }
+
+            const std::vector<std::pair<EdgeId, EdgeId>>& GetShortcuts() const
+            {
+                return shortcuts_;
+            }
+
+        private:
+            // keeps only the lightest arc between two vertices; false if an arc at least as light exists
+            bool AddArc(VertexId from, VertexId to, double weight, EdgeId id)
+            {
+                for(BuildArc& arc : out_[from])
+                {
+                    if(arc.other != to)
+                    {
+                        continue;
+                    }
+
+                    if(arc.weight <= weight)
+                    {
+                        return false;
+                    }
+
+                    arc.weight = weight;
+                    arc.id = id;
+
+                    for(BuildArc& back : in_[to])
+                    {
+                        if(back.other == from)
+                        {
+                            back.weight = weight;
+                            back.id = id;
+                            break;
+                        }
+                    }
+                    return true;
+                }
+
+                out_[from].push_back({to, weight, id});
+                in_[to].push_back({from, weight, id});
+                return true;
+            }
+
+            static void RemoveArc(std::vector<BuildArc>& arcs, VertexId other)
+            {
+                for(BuildArc& arc : arcs)
+                {
+                    if(arc.other == other)
+                    {
+                        arc = arcs.back();
+                        arcs.pop_back();
+                        return;
+                    }
+                }
+            }
+
+            // distances from source around skipped, until every target is settled, the
+            // distance passes limit or the settle limit is reached
+            void WitnessSearch(VertexId source, VertexId skipped, double limit, size_t target_count, size_t settle_limit)
+            {
+                for(VertexId v : touched_)
+                {
+                    witness_distances_[v] = INFINITE_WEIGHT;
+                }
+
+                touched_.clear();
+                heap_.clear();
+
+                witness_distances_[source] = 0;
+                touched_.push_back(source);
+                heap_.emplace_back(0, source);
+
+                size_t settled = 0;
+
+                while(!heap_.empty() && settled < settle_limit)
+                {
+                    std::pop_heap(heap_.begin(), heap_.end(), std::greater<>{});
+                    auto [distance, v] = heap_.back();
+                    heap_.pop_back();
+
+                    if(distance > witness_distances_[v])
+                    {
+                        continue;
+                    }
+
+                    if(distance > limit)
+                    {
+                        break;
+                    }
+
+                    settled++;
+
+                    if(is_target_[v] && --target_count == 0)
+                    {
+                        break;
+                    }
+
+                    for(const BuildArc& arc : out_[v])
+                    {
+                        double candidate = distance + arc.weight;
+
+                        if(arc.other == skipped || candidate >= witness_distances_[arc.other])
+                        {
+                            continue;
+                        }
+
+                        if(witness_distances_[arc.other] == INFINITE_WEIGHT)
+                        {
+                            touched_.push_back(arc.other);
+                        }
+
+                        witness_distances_[arc.other] = candidate;
+                        heap_.emplace_back(candidate, arc.other);
+                        std::push_heap(heap_.begin(), heap_.end(), std::greater<>{});
+                    }
+                }
+            }
+
+            // number of shortcuts contracting v needs; they are added unless simulate is set
+            int ProcessVertex(VertexId v, bool simulate)
+            {
+                double max_out = 0;
+
+                for(const BuildArc& arc : out_[v])
+                {
+                    max_out = std::max(max_out, arc.weight);
+                    is_target_[arc.other] = true;
+                }
+
+                int shortcuts = 0;
+
+                // AddArc changes lists of u and of the targets only, never those of v
+                for(const BuildArc& in_arc : in_[v])
+                {
+                    VertexId u = in_arc.other;
+
+                    WitnessSearch(u, v, in_arc.weight + max_out, out_[v].size() - (is_target_[u] ? 1 : 0), 
+                                  simulate ? ESTIMATE_SETTLE_LIMIT : WITNESS_SETTLE_LIMIT);
+
+                    for(const BuildArc& out_arc : out_[v])
+                    {
+                        VertexId target = out_arc.other;
+                        double via = in_arc.weight + out_arc.weight;
+
+                        if(target == u || witness_distances_[target] <= via)
+                        {
+                            continue;
+                        }
+
+                        shortcuts++;
+
+                        if(!simulate && AddArc(u, target, via, static_cast<EdgeId>(edge_count_ + shortcuts_.size())))
+                        {
+                            shortcuts_.emplace_back(in_arc.id, out_arc.id);
+                        }
+                    }
+                }
+
+                for(const BuildArc& arc : out_[v])
+                {
+                    is_target_[arc.other] = false;
+                }
+                return shortcuts;
+            }
+
+            int Priority(VertexId v)
+            {
+                int removed = static_cast<int>(out_[v].size() + in_[v].size());
+
+                return 2 * (ProcessVertex(v, true) - removed) + contracted_neighbors_[v] + levels_[v];
+            }
+
+            void Contract(VertexId v)
+            {
+                ProcessVertex(v, false);
+
+                for(const BuildArc& arc : out_[v])
+                {
+                    RemoveArc(in_[arc.other], v);
+                    contracted_neighbors_[arc.other]++;
+                    levels_[arc.other] = std::max(levels_[arc.other], levels_[v] + 1);
+                }
+
+                for(const BuildArc& arc : in_[v])
+                {
+                    RemoveArc(out_[arc.other], v);
+                    contracted_neighbors_[arc.other]++;
+                    levels_[arc.other] = std::max(levels_[arc.other], levels_[v] + 1);
+                }
+
+                up_[v] = std::move(out_[v]);
+                down_[v] = std::move(in_[v]);
+                out_[v].clear();
+                in_[v].clear();
+            }
+
+            size_t edge_count_;
+            // arcs between vertices not contracted yet
+            std::vector<std::vector<BuildArc>> out_;
+            std::vector<std::vector<BuildArc>> in_;
+            std::vector<std::vector<BuildArc>> up_;
+            std::vector<std::vector<BuildArc>> down_;
+            std::vector<int> contracted_neighbors_;
+            std::vector<int> levels_;
+            std::vector<std::pair<EdgeId, EdgeId>> shortcuts_;
+
+            std::vector<double> witness_distances_;
+            std::vector<VertexId> touched_;
+            std::vector<HeapEntry> heap_;
+            // out-neighbours of the vertex being processed
+            std::vector<bool> is_target_;
+        };
+
+        // both searches of a query; entries are valid only where the stamp matches the
+        // current query, so nothing is cleared between queries
+        struct QueryState
+        {
+            struct Side
+            {
+                std::vector<uint32_t> stamps;
+                std::vector<double> distances;
+                std::vector<VertexId> parents;
+                std::vector<EdgeId> parent_edges;
+                std::vector<HeapEntry> heap;
+            };
+
+            void Reset(size_t vertex_count)
+            {
+                if(sides[0].stamps.size() != vertex_count || ++stamp == 0)
+                {
+                    for(Side& side : sides)
+                    {
+                        side.stamps.assign(vertex_count, 0);
+                        side.distances.resize(vertex_count);
+                        side.parents.resize(vertex_count);
+                        side.parent_edges.resize(vertex_count);
+                    }
+                    stamp = 1;
+                }
+
+                for(Side& side : sides)
+                {
+                    side.heap.clear();
+                }
+            }
+
+            double Distance(int side, VertexId v) const
+            {
+                return sides[side].stamps[v] == stamp ? sides[side].distances[v] : INFINITE_WEIGHT;
+            }
+
+            void Reach(int side, VertexId v, double distance, VertexId parent, EdgeId edge)
+            {
+                Side& s = sides[side];
+
+                s.stamps[v] = stamp;
+                s.distances[v] = distance;
+                s.parents[v] = parent;
+                s.parent_edges[v] = edge;
+                s.heap.emplace_back(distance, v);
+                std::push_heap(s.heap.begin(), s.heap.end(), std::greater<>{});
+            }
+
+            Side sides[2];
+            uint32_t stamp = 0;
+        };
+
+        template<typename T>
+        void AppendArray(std::vector<char>& buffer, const std::vector<T>& items)
+        {
+            const char* data = reinterpret_cast<const char*>(items.data());
+            buffer.insert(buffer.end(), data, data + items.size() * sizeof(T));
+        }
+
+        template<typename T>
+        void ReadArray(const char*& data, std::vector<T>& items, uint64_t count)
+        {
+            items.resize(count);
+
+            if(count > 0)
+            {
+                std::memcpy(items.data(), data, count * sizeof(T));
+            }
+            data += count * sizeof(T);
+        }
+    }
+
+    ContractionHierarchy ContractionHierarchy::Build(const DirectedWeightedGraph<double>& graph)
+    {
+        Contractor contractor(graph);
+
+        contractor.Run();
+
+        ContractionHierarchy result;
+
+        result.vertex_count_ = graph.GetVertexCount();
+        result.edge_count_ = graph.GetEdgeCount();
+        result.fingerprint_ = Fingerprint(graph);
+        for(const auto& [first, second] : contractor.GetShortcuts())
+        {
+            result.shortcuts_.push_back({first, second});
+        }
+
+        const auto& up = contractor.GetUpArcs();
+        const auto& down = contractor.GetDownArcs();
+
+        result.up_offsets_.assign(1, 0);
+        result.down_offsets_.assign(1, 0);
+
+        for(VertexId v = 0; v < result.vertex_count_; v++)
+        {
+            for(const auto& arc : up[v])
+            {
+                result.up_arcs_.push_back({arc.weight, arc.other, arc.id});
+            }
+
+            for(const auto& arc : down[v])
+            {
+                result.down_arcs_.push_back({arc.weight, arc.other, arc.id});
+            }
+
+            result.up_offsets_.push_back(static_cast<uint32_t>(result.up_arcs_.size()));
+            result.down_offsets_.push_back(static_cast<uint32_t>(result.down_arcs_.size()));
+        }
+
+        return result;
+    }
+
+    std::optional<ContractionHierarchy::RouteInfo> ContractionHierarchy::BuildRoute(VertexId from, VertexId to) const
+    {
+        static thread_local QueryState state;
+
+        state.Reset(vertex_count_);
+        state.Reach(0, from, 0, NO_VERTEX, 0);
+        state.Reach(1, to, 0, NO_VERTEX, 0);
+
+        double best = INFINITE_WEIGHT;
+        VertexId meeting = NO_VERTEX;
+
+        while(true)
+        {
+            double tops[2];
+
+            for(int side = 0; side < 2; side++)
+            {
+                tops[side] = state.sides[side].heap.empty() ? INFINITE_WEIGHT : state.sides[side].heap.front().first;
+            }
+
+            // neither search can improve on a route found already
+            if(std::min(tops[0], tops[1]) >= best)
+            {
+                break;
+            }
+
+            int side = tops[0] <= tops[1] ? 0 : 1;
+            auto& heap = state.sides[side].heap;
+
+            std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+            auto [distance, v] = heap.back();
+            heap.pop_back();
+
+            if(distance > state.Distance(side, v))
+            {
+                continue;
+            }
+
+            double total = distance + state.Distance(1 - side, v);
+
+            if(total < best)
+            {
+                best = total;
+                meeting = v;
+            }
+
+            const auto& offsets = side == 0 ? up_offsets_ : down_offsets_;
+            const auto& arcs = side == 0 ? up_arcs_ : down_arcs_;
+
+            // stall on demand: a vertex reached cheaper from above through an arc the search
+            // cannot use lies on no shortest path, so its arcs are not followed
+            const auto& reverse_offsets = side == 0 ? down_offsets_ : up_offsets_;
+            const auto& reverse_arcs = side == 0 ? down_arcs_ : up_arcs_;
+            bool stalled = false;
+
+            for(uint32_t i = reverse_offsets[v]; i < reverse_offsets[v + 1] && !stalled; i++)
+            {
+                stalled = state.Distance(side, reverse_arcs[i].to) + reverse_arcs[i].weight < distance;
+            }
+
+            if(stalled)
+            {
+                continue;
+            }
+
+            for(uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+            {
+                const Arc& arc = arcs[i];
+                double candidate = distance + arc.weight;
+
+                if(candidate < state.Distance(side, arc.to))
+                {
+                    state.Reach(side, arc.to, candidate, v, arc.id);
+                }
+            }
+        }
+
+        if(meeting == NO_VERTEX)
+        {
+            return std::nullopt;
+        }
+
+        // the forward half is collected from the meeting point back and then reversed
+        std::vector<EdgeId> path;
+
+        for(VertexId v = meeting; v != from; v = state.sides[0].parents[v])
+        {
+            path.push_back(state.sides[0].parent_edges[v]);
+        }
+
+        std::reverse(path.begin(), path.end());
+
+        for(VertexId v = meeting; v != to; v = state.sides[1].parents[v])
+        {
+            path.push_back(state.sides[1].parent_edges[v]);
+        }
+
+        RouteInfo result{best, {}};
+
+        for(EdgeId id : path)
+        {
+            UnpackEdge(id, result.edges);
+        }
+
+        return result;
+    }
+
+    void ContractionHierarchy::UnpackEdge(EdgeId id, std::vector<EdgeId>& edges) const
+    {
+        // explicit stack, second halves pushed first; shortcuts may nest deeply
+        std::vector<EdgeId> stack{id};
+
+        while(!stack.empty())
+        {
+            EdgeId top = stack.back();
+            stack.pop_back();
+
+            if(top < edge_count_)
+            {
+                edges.push_back(top);
+                continue;
+            }
+
+            const Shortcut& shortcut = shortcuts_[top - edge_count_];
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+
+    size_t ContractionHierarchy::GetShortcutCount() const
+    {
+        return shortcuts_.size();
+    }
+
+    uint64_t ContractionHierarchy::Fingerprint(const DirectedWeightedGraph<double>& graph)
+    {
+        Fnv1a hash;
+        uint64_t vertex_count = graph.GetVertexCount();
+
+        hash.Add(&vertex_count, sizeof(vertex_count));
+
+        for(EdgeId id = 0; id < graph.GetEdgeCount(); id++)
+        {
+            const Edge<double>& edge = graph.GetEdge(id);
+
+            hash.Add(&edge.from, sizeof(edge.from));
+            hash.Add(&edge.to, sizeof(edge.to));
+            hash.Add(&edge.weight, sizeof(edge.weight));
+        }
+        return hash.Get();
+    }
+
+    void ContractionHierarchy::Save(const std::string& path) const
+    {
+        std::vector<char> buffer(sizeof(Header));
+
+        AppendArray(buffer, shortcuts_);
+        AppendArray(buffer, up_offsets_);
+        AppendArray(buffer, up_arcs_);
+        AppendArray(buffer, down_offsets_);
+        AppendArray(buffer, down_arcs_);
+
+        Fnv1a checksum;
+        checksum.Add(buffer.data() + sizeof(Header), buffer.size() - sizeof(Header));
+
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.vertex_count = vertex_count_;
+        header.edge_count = edge_count_;
+        header.fingerprint = fingerprint_;
+        header.shortcut_count = shortcuts_.size();
+        header.up_arc_count = up_arcs_.size();
+        header.down_arc_count = down_arcs_.size();
+        header.checksum = checksum.Get();
+
+        std::memcpy(buffer.data(), &header, sizeof(Header));
+
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+
+        if(!output.write(buffer.data(), buffer.size()))
+        {
+            throw std::runtime_error("cannot write hierarchy " + path);
+        }
+    }
+
+    ContractionHierarchy ContractionHierarchy::Load(const std::string& path, const DirectedWeightedGraph<double>& graph)
+    {
+        std::ifstream input(path, std::ios::binary);
+
+        if(!input)
+        {
+            throw std::runtime_error("cannot open hierarchy " + path);
+        }
+
+        std::vector<char> buffer((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+        Header header;
+
+        if(buffer.size() < sizeof(Header))
+        {
+            throw std::runtime_error("hierarchy is truncated");
+        }
+
+        std::memcpy(&header, buffer.data(), sizeof(Header));
+
+        if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            throw std::runtime_error("not a contraction hierarchy");
+        }
+
+        if(header.version != VERSION || header.byte_order != BYTE_ORDER_MARK)
+        {
+            throw std::runtime_error("unsupported hierarchy format");
+        }
+
+        if(header.vertex_count != graph.GetVertexCount() || header.edge_count != graph.GetEdgeCount() || header.fingerprint != Fingerprint(graph))
+        {
+            throw std::runtime_error("hierarchy was built for another graph");
+        }
+
+        // counts are checked one by one so that a damaged header cannot overflow the sum
+        const uint64_t limit = buffer.size();
+
+        if(header.shortcut_count > limit || header.up_arc_count > limit || header.down_arc_count > limit)
+        {
+            throw std::runtime_error("hierarchy is truncated");
+        }
+
+        uint64_t expected_size = sizeof(Header) 
+                               + header.shortcut_count * sizeof(Shortcut) 
+                               + 2 * (header.vertex_count + 1) * sizeof(uint32_t) 
+                               + (header.up_arc_count + header.down_arc_count) * sizeof(Arc);
+
+        if(expected_size != buffer.size())
+        {
+            throw std::runtime_error("hierarchy is truncated");
+        }
+
+        Fnv1a checksum;
+        checksum.Add(buffer.data() + sizeof(Header), buffer.size() - sizeof(Header));
+
+        if(checksum.Get() != header.checksum)
+        {
+            throw std::runtime_error("hierarchy checksum mismatch");
+        }
+
+        ContractionHierarchy result;
+
+        result.vertex_count_ = header.vertex_count;
+        result.edge_count_ = header.edge_count;
+        result.fingerprint_ = header.fingerprint;
+
+        const char* data = buffer.data() + sizeof(Header);
+
+        ReadArray(data, result.shortcuts_, header.shortcut_count);
+        ReadArray(data, result.up_offsets_, header.vertex_count + 1);
+        ReadArray(data, result.up_arcs_, header.up_arc_count);
+        ReadArray(data, result.down_offsets_, header.vertex_count + 1);
+        ReadArray(data, result.down_arcs_, header.down_arc_count);
+
+        if(result.up_offsets_.back() != result.up_arcs_.size() || result.down_offsets_.back() != result.down_arcs_.size())
+        {
+            throw std::runtime_error("hierarchy is damaged");
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+#include "graph.h"
+#include "router.h"
+
+namespace graph
+{
+    // Contraction hierarchy over a built graph. Vertices are contracted one by one, least
+    // important first, and a shortcut replaces every shortest path that ran through the
+    // contracted vertex. A query then searches only towards more important vertices, forward
+    // from the source and backward from the target, and the shortcuts on the best path are
+    // unpacked into edges of the original graph. The result can be saved and loaded again
+    // for the same graph, so preprocessing is done once per dataset
+    class ContractionHierarchy
+    {
+    public:
+        using RouteInfo = Router<double>::RouteInfo;
+
+        static ContractionHierarchy Build(const DirectedWeightedGraph<double>& graph);
+
+        // throws std::runtime_error for a damaged file or one made for another graph
+        static ContractionHierarchy Load(const std::string& path, const DirectedWeightedGraph<double>& graph);
+
+        void Save(const std::string& path) const;
+
+        // a shortest route as Router::BuildRoute gives it; may be called from several threads
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+        size_t GetShortcutCount() const;
+
+    private:
+        // the two edges a shortcut stands for, in path order
+        struct Shortcut
+        {
+            EdgeId first;
+            EdgeId second;
+        };
+
+        // weight first, so the struct has no padding and is saved byte for byte
+        struct Arc
+        {
+            double weight;
+            VertexId to;
+            EdgeId id;
+        };
+
+        ContractionHierarchy() = default;
+
+        static uint64_t Fingerprint(const DirectedWeightedGraph<double>& graph);
+
+        void UnpackEdge(EdgeId id, std::vector<EdgeId>& edges) const;
+
+        size_t vertex_count_ = 0;
+        // ids below edge_count_ are edges of the graph, shortcut i has id edge_count_ + i
+        size_t edge_count_ = 0;
+        uint64_t fingerprint_ = 0;
+        std::vector<Shortcut> shortcuts_;
+        // edges to more important vertices, by source
+        std::vector<uint32_t> up_offsets_;
+        std::vector<Arc> up_arcs_;
+        // edges from more important vertices, by target; Arc::to is the source there
+        std::vector<uint32_t> down_offsets_;
+        std::vector<Arc> down_arcs_;
+    };
+}
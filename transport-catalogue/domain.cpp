@@ -12,9 +12,6 @@ namespace domain
 
     bool Stop::operator==(const Stop& other) const
     {
-        return other.name_ == name_;
+        return other.id_ == id_;
     }
-
-    Route::Route(std::vector<const Stop*> stops, bool is_circular) : stops_(std::move(stops)), is_circular_(is_circular) {}
-    
 }
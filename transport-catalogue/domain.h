@@ -1,5 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
 #include "geo.h"
@@ -7,29 +9,56 @@
 
 namespace domain
 {
+    using StopId = uint32_t;
+    using BusId = uint32_t;
+
+    template<typename T>
+    class Span
+    {
+    public:
+        Span() = default;
+        Span(const T* data, size_t size) : data_(data), size_(size) {}
+
+        const T* begin() const { return data_; }
+        const T* end() const { return data_ + size_; }
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        const T& operator[](size_t i) const { return data_[i]; }
+
+    private:
+        const T* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
     struct Stop
     {
-        std::string name_;
+        StopId id_;
+        std::string_view name_;
         geo::Coordinates coordinates_;
 
-        Stop(std::string name, geo::Coordinates coordinates) : name_(name), coordinates_(coordinates){}
-
         bool operator==(const Stop& other) const;
     };
 
     struct Route
     {
-        Route(std::vector<const Stop*> stops, bool is_circular);
-        std::vector<const Stop*> stops_;
+        Span<StopId> stops_;
         bool is_circular_;
     };
 
-    template<typename T>
+    struct BusStats
+    {
+        int route_length = 0;
+        double geo_length = 0.;
+        double curvature = 0.;
+        int stop_count = 0;
+        int unique_stop_count = 0;
+    };
+
     struct StopPairHash
     {
-        size_t operator()(std::pair<const T*, const T*> pair) const
+        size_t operator()(std::pair<StopId, StopId> pair) const
         {
-            return (std::hash<const void*>{}(pair.first) * 37) + (std::hash<const void*>{}(pair.second) * 37 * 37);
+            return std::hash<uint64_t>{}((static_cast<uint64_t>(pair.first) << 32) | pair.second);
         }
     };
 
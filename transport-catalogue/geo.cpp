@@ -14,7 +14,7 @@ namespace geo
         static const double dr = M_PI / 180.;
         return acos(sin(from.lat * dr) * sin(to.lat * dr)
                     + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-            * 6371000;
+            * EARTH_RADIUS;
     }
 
     bool Coordinates::operator==(const Coordinates& other) const 
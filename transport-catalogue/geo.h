@@ -10,6 +10,8 @@ namespace geo
         bool operator!=(const Coordinates& other) const;
     };
 
+    inline const double EARTH_RADIUS = 6371000;
+
     double ComputeDistance(Coordinates from, Coordinates to);
 }
 
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "domain.h"
+
+namespace graph
+{
+    using VertexId = uint32_t;
+    using EdgeId = uint32_t;
+
+    template<typename Weight>
+    struct Edge
+    {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+    };
+
+    // Edges are added first, then Build() lays out the outgoing edges of every vertex
+    // next to each other (compressed sparse rows) so a search reads them in one run.
+    // Edge ids are given in the order of AddEdge calls and stay valid after Build()
+    template<typename Weight>
+    class DirectedWeightedGraph
+    {
+    public:
+        // an outgoing edge as stored in the rows
+        struct OutEdge
+        {
+            VertexId to;
+            Weight weight;
+            EdgeId id;
+        };
+
+        DirectedWeightedGraph() = default;
+        explicit DirectedWeightedGraph(size_t vertex_count) : vertex_count_(vertex_count) {}
+
+        EdgeId AddEdge(const Edge<Weight>& edge);
+        void Build();
+
+        size_t GetVertexCount() const;
+        size_t GetEdgeCount() const;
+        const Edge<Weight>& GetEdge(EdgeId id) const;
+        // only after Build()
+        domain::Span<OutEdge> GetOutgoingEdges(VertexId vertex) const;
+
+    private:
+        size_t vertex_count_ = 0;
+        std::vector<Edge<Weight>> edges_;
+        // edges leaving vertex v are out_edges_[offsets_[v] .. offsets_[v + 1])
+        std::vector<uint32_t> offsets_;
+        std::vector<OutEdge> out_edges_;
+    };
+
+    template<typename Weight>
+    EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge)
+    {
+        if(!offsets_.empty())
+        {
+            throw std::logic_error("graph is already built");
+        }
+
+        if(edge.from >= vertex_count_ || edge.to >= vertex_count_)
+        {
+            throw std::out_of_range("edge vertex is out of range");
+        }
+
+        edges_.push_back(edge);
+
+        return static_cast<EdgeId>(edges_.size() - 1);
+    }
+
+    template<typename Weight>
+    void DirectedWeightedGraph<Weight>::Build()
+    {
+        // counting sort of the edges by source vertex
+        offsets_.assign(vertex_count_ + 1, 0);
+
+        for(const auto& edge : edges_)
+        {
+            offsets_[edge.from + 1]++;
+        }
+
+        for(size_t v = 0; v < vertex_count_; v++)
+        {
+            offsets_[v + 1] += offsets_[v];
+        }
+
+        std::vector<uint32_t> next(offsets_.begin(), offsets_.end() - 1);
+
+        out_edges_.resize(edges_.size());
+
+        for(EdgeId id = 0; id < edges_.size(); id++)
+        {
+            const Edge<Weight>& edge = edges_[id];
+            out_edges_[next[edge.from]++] = {edge.to, edge.weight, id};
+        }
+    }
+
+    template<typename Weight>
+    size_t DirectedWeightedGraph<Weight>::GetVertexCount() const
+    {
+        return vertex_count_;
+    }
+
+    template<typename Weight>
+    size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const
+    {
+        return edges_.size();
+    }
+
+    template<typename Weight>
+    const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId id) const
+    {
+        return edges_[id];
+    }
+
+    template<typename Weight>
+    domain::Span<typename DirectedWeightedGraph<Weight>::OutEdge> DirectedWeightedGraph<Weight>::GetOutgoingEdges(VertexId vertex) const
+    {
+        return {out_edges_.data() + offsets_[vertex], offsets_[vertex + 1] - offsets_[vertex]};
+    }
+}
@@ -1,5 +1,8 @@
 #include "json.h"
+#include "json_scan.h"
 
+#include <cctype>
+#include <charconv>
 #include <iterator>
 
 namespace json {
@@ -7,101 +10,273 @@ namespace json {
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
-Node LoadString(std::istream& input);
-
-std::string LoadLiteral(std::istream& input) 
+// recursive-descent parser emitting events to a handler; it scans a contiguous
+// buffer which is refilled from the stream when one is given
+template <typename H>
+class Parser 
 {
-    std::string s;
+public:
+    Parser(std::string_view input, H& handler) : pos_(input.data()), end_(input.data() + input.size()), handler_(handler) 
+    {
+    }
 
-    while (std::isalpha(input.peek())) 
+    Parser(std::istream& input, H& handler) : input_(&input), buffer_(1 << 16), pos_(buffer_.data()), end_(pos_), handler_(handler) 
     {
-        s.push_back(static_cast<char>(input.get()));
     }
-    return s;
-}
 
-Node LoadArray(std::istream& input) 
-{
-    std::vector<Node> result;
+    void ParseNode() 
+    {
+        SkipWhitespace();
+
+        if (AtEnd()) 
+        {
+            throw ParsingError("Unexpected EOF"s);
+        }
+
+        switch (*pos_) 
+        {
+            case '[':
+                ++pos_;
+                ParseArray();
+                break;
+
+            case '{':
+                ++pos_;
+                ParseDict();
+                break;
+
+            case '"':
+                ++pos_;
+                handler_.String(ParseString());
+                break;
 
-    for (char c; input >> c && c != ']';) 
+            case 't':
+                ExpectLiteral("true"sv);
+                handler_.Value(Node{true});
+                break;
+
+            case 'f':
+                ExpectLiteral("false"sv);
+                handler_.Value(Node{false});
+                break;
+
+            case 'n':
+                ExpectLiteral("null"sv);
+                handler_.Value(Node{nullptr});
+                break;
+
+            default:
+                handler_.Value(ParseNumber());
+                break;
+        }
+    }
+
+private:
+    // true once the input is exhausted; refills the buffer from the stream first
+    bool AtEnd() 
     {
-        if (c != ',') 
+        if (pos_ != end_) 
+        {
+            return false;
+        }
+
+        if (input_ == nullptr) 
         {
-            input.putback(c);
+            return true;
         }
 
-        result.push_back(LoadNode(input));
+        input_->read(buffer_.data(), buffer_.size());
+        pos_ = buffer_.data();
+        end_ = pos_ + input_->gcount();
+        return pos_ == end_;
     }
-    if (!input) 
+
+    // appends the run that find(first, last) measures to out, across buffer refills
+    template <typename Find>
+    void AppendRun(std::string& out, Find find) 
     {
-        throw ParsingError("Array parsing error"s);
+        while (!AtEnd()) 
+        {
+            const char* start = pos_;
+
+            pos_ = find(pos_, end_);
+
+            out.append(start, pos_ - start);
+
+            if (pos_ != end_) 
+            {
+                return;
+            }
+        }
     }
-    return Node(std::move(result));
-}
 
-Node LoadDict(std::istream& input) 
-{
-    Dict dict;
+    static bool IsWhitespace(char c) 
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
 
-    for (char c; input >> c && c != '}';) 
+    void SkipWhitespace() 
     {
-        if (c == '"') 
+        // tokens are mostly separated by one space or none, which is checked in place
+        // before handing a longer run to the scanner
+        while (!AtEnd()) 
         {
-            std::string key = LoadString(input).AsString();
-
-            if (input >> c && c == ':') 
+            if (!IsWhitespace(*pos_)) 
             {
-                if (dict.find(key) != dict.end()) 
-                {
-                    throw ParsingError("Duplicate key '"s + key + "' have been found");
-                }
-
-                dict.emplace(std::move(key), LoadNode(input));
-            } 
-            else 
+                return;
+            }
+
+            pos_ = scan_.skip_whitespace(pos_ + 1, end_);
+
+            if (pos_ != end_) 
             {
-                throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                return;
             }
-        } 
-        else if (c != ',') 
+        }
+    }
+
+    // skips whitespace and consumes c if it is next
+    bool Consume(char c) 
+    {
+        SkipWhitespace();
+
+        if (!AtEnd() && *pos_ == c) 
         {
-            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            ++pos_;
+            return true;
         }
+        return false;
     }
-    if (!input) 
+
+    void ExpectLiteral(std::string_view literal) 
     {
-        throw ParsingError("Dictionary parsing error"s);
+        std::string word;
+
+        AppendRun(word, [](const char* first, const char* last) 
+        {
+            return std::find_if(first, last, [](char c) 
+            {
+                return std::isalpha(static_cast<unsigned char>(c)) == 0;
+            });
+        });
+
+        if (word != literal) 
+        {
+            throw ParsingError("Failed to parse '"s + word + "' as "s + std::string(literal));
+        }
     }
-    return Node(std::move(dict));
-}
 
-Node LoadString(std::istream& input) {
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
-    while (true) 
+    void ParseArray() 
     {
-        if (it == end) 
+        handler_.StartArray();
+
+        if (Consume(']')) 
         {
-            throw ParsingError("String parsing error");
+            handler_.EndArray();
+            return;
         }
-        const char ch = *it;
-        if (ch == '"') 
+
+        do 
         {
-            ++it;
-            break;
+            ParseNode();
         } 
-        else if (ch == '\\') 
+        while (Consume(','));
+
+        if (!Consume(']')) 
         {
-            ++it;
-            if (it == end) 
+            throw ParsingError("Array parsing error"s);
+        }
+        handler_.EndArray();
+    }
+
+    void ParseDict() 
+    {
+        handler_.StartDict();
+
+        if (Consume('}')) 
+        {
+            handler_.EndDict();
+            return;
+        }
+
+        do 
+        {
+            if (!Consume('"')) 
+            {
+                throw ParsingError("Dictionary key is expected"s);
+            }
+
+            std::string_view key = ParseString();
+
+            // a refill while looking for ':' may overwrite the stream buffer the key points into
+            if (input_ != nullptr && key.data() != scratch_.data()) 
+            {
+                scratch_.assign(key);
+                key = scratch_;
+            }
+
+            if (!Consume(':')) 
+            {
+                throw ParsingError("':' is expected after key '"s + std::string(key) + "'"s);
+            }
+
+            handler_.Key(key);
+            ParseNode();
+        } 
+        while (Consume(','));
+
+        if (!Consume('}')) 
+        {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        handler_.EndDict();
+    }
+
+    // called after the opening quote. A string without escapes that lies in the buffer is
+    // returned as a view of it; otherwise unescaped runs are appended in one piece to a
+    // scratch buffer reused by the next string
+    std::string_view ParseString() 
+    {
+        const char* start = pos_;
+        const char* end = scan_.find_string_end(start, end_);
+
+        if (end != end_ && *end == '"') 
+        {
+            pos_ = end + 1;
+            return std::string_view(start, end - start);
+        }
+
+        std::string& s = scratch_;
+
+        s.clear();
+
+        while (true) 
+        {
+            AppendRun(s, scan_.find_string_end);
+
+            if (AtEnd()) 
             {
                 throw ParsingError("String parsing error");
             }
 
-            const char escaped_char = *(it);
+            const char ch = *pos_++;
+
+            if (ch == '"') 
+            {
+                return s;
+            }
+
+            if (ch != '\\') 
+            {
+                throw ParsingError("Unexpected end of line"s);
+            }
+
+            if (AtEnd()) 
+            {
+                throw ParsingError("String parsing error");
+            }
+
+            const char escaped_char = *pos_++;
 
             switch (escaped_char) 
             {
@@ -128,167 +303,116 @@ Node LoadString(std::istream& input) {
                 default:
                     throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
             }
-        } 
-        else if (ch == '\n' || ch == '\r') 
-        {
-            throw ParsingError("Unexpected end of line"s);
-        } 
-        else 
-        {
-            s.push_back(ch);
         }
-        ++it;
     }
-    return Node(std::move(s));
-}
 
-Node LoadBool(std::istream& input) 
-{
-    const auto s = LoadLiteral(input);
-
-    if (s == "true"sv) 
-    {
-        return Node{true};
-    } 
-    else if (s == "false"sv) 
+    // a number that lies in the buffer is returned as a view of it, otherwise it is
+    // collected in the scratch buffer
+    std::string_view ScanNumber() 
     {
-        return Node{false};
-    } 
-    else 
-    {
-        throw ParsingError("Failed to parse '"s + s + "' as bool"s);
-    }
-}
+        const char* start = pos_;
 
-Node LoadNull(std::istream& input) 
-{
-    if (auto literal = LoadLiteral(input); literal == "null"sv) 
-    {
-        return Node{nullptr};
-    } 
-    else 
-    {
-        throw ParsingError("Failed to parse '"s + literal + "' as null"s);
-    }
-}
+        pos_ = scan_.find_number_end(pos_, end_);
 
-Node LoadNumber(std::istream& input) 
-{
-    std::string parsed_num;
+        if (pos_ != end_ || input_ == nullptr) 
+        {
+            return std::string_view(start, pos_ - start);
+        }
+
+        scratch_.assign(start, pos_ - start);
+        AppendRun(scratch_, scan_.find_number_end);
+        return scratch_;
+    }
 
-    auto read_char = [&parsed_num, &input] 
+    Node ParseNumber() 
     {
-        parsed_num += static_cast<char>(input.get());
+        const std::string_view parsed_num = ScanNumber();
 
-        if (!input) 
+        const char* pos = parsed_num.data();
+        const char* end = pos + parsed_num.size();
+
+        auto read_digits = [&] 
         {
-            throw ParsingError("Failed to read number from stream"s);
-        }
-    };
+            if (pos == end || *pos < '0' || *pos > '9') 
+            {
+                throw ParsingError("A digit is expected"s);
+            }
 
-    auto read_digits = [&input, read_char] 
-    {
-        if (!std::isdigit(input.peek())) 
+            while (pos != end && *pos >= '0' && *pos <= '9') 
+            {
+                ++pos;
+            }
+        };
+
+        if (pos != end && *pos == '-') 
         {
-            throw ParsingError("A digit is expected"s);
+            ++pos;
         }
 
-        while (std::isdigit(input.peek())) 
+        if (pos != end && *pos == '0') 
         {
-            read_char();
+            ++pos;
+        } 
+        else 
+        {
+            read_digits();
         }
-    };
 
-    if (input.peek() == '-') 
-    {
-        read_char();
-    }
+        bool is_int = true;
 
-    if (input.peek() == '0') 
-    {
-        read_char();
-    } 
-    else 
-    {
-        read_digits();
-    }
+        if (pos != end && *pos == '.') 
+        {
+            ++pos;
+            read_digits();
+            is_int = false;
+        }
 
-    bool is_int = true;
+        if (pos != end && (*pos == 'e' || *pos == 'E')) 
+        {
+            ++pos;
 
-    if (input.peek() == '.') 
-    {
-        read_char();
-        read_digits();
-        is_int = false;
-    }
+            if (pos != end && (*pos == '+' || *pos == '-')) 
+            {
+                ++pos;
+            }
 
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') 
-    {
-        read_char();
+            read_digits();
+            is_int = false;
+        }
 
-        if (ch = input.peek(); ch == '+' || ch == '-') 
+        if (pos != end) 
         {
-            read_char();
+            throw ParsingError("Failed to parse '"s + std::string(parsed_num) + "' as number"s);
         }
 
-        read_digits();
-        is_int = false;
-    }
-
-    try 
-    {
+        // integers that do not fit into int are read as double
         if (is_int) 
         {
-            try 
-            {
-                return std::stoi(parsed_num);
-            } 
-            catch (...) 
+            int value = 0;
+
+            if (std::from_chars(parsed_num.data(), end, value).ec == std::errc{}) 
             {
+                return value;
             }
         }
-        return std::stod(parsed_num);
-    } 
-    catch (...) 
-    {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
-    }
-}
-
-Node LoadNode(std::istream& input) 
-{
-    char c;
-    if (!(input >> c)) 
-    {
-        throw ParsingError("Unexpected EOF"s);
-    }
-
-    switch (c) 
-    {
-        case '[':
-            return LoadArray(input);
-
-        case '{':
-            return LoadDict(input);
-
-        case '"':
-            return LoadString(input);
-
-        case 't':
-            [[fallthrough]];
-        case 'f':
-            input.putback(c);
-            return LoadBool(input);
 
-        case 'n':
-            input.putback(c);
-            return LoadNull(input);
+        double value = 0;
 
-        default:
-            input.putback(c);
-            return LoadNumber(input);
+        if (std::from_chars(parsed_num.data(), end, value).ec != std::errc{}) 
+        {
+            throw ParsingError("Failed to convert "s + std::string(parsed_num) + " to number"s);
+        }
+        return value;
     }
-}
+
+    const scan::Scanners& scan_ = scan::GetScanners();
+    std::istream* input_ = nullptr;
+    std::vector<char> buffer_;
+    std::string scratch_;
+    const char* pos_;
+    const char* end_;
+    H& handler_;
+};
 
 struct PrintContext 
 {
@@ -315,10 +439,10 @@ void PrintNode(const Node& value, const PrintContext& ctx);
 template <typename Value>
 void PrintValue(const Value& value, const PrintContext& ctx) 
 {
-    ctx.out << value;
+    PrintNumber(value, ctx.out);
 }
 
-void PrintString(const std::string& value, std::ostream& out) 
+void PrintString(std::string_view value, std::ostream& out) 
 {
     out.put('"');
     for (const char c : value) 
@@ -349,7 +473,7 @@ void PrintString(const std::string& value, std::ostream& out)
 }
 
 template <>
-void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) 
+void PrintValue<String>(const String& value, const PrintContext& ctx) 
 {
     PrintString(value, ctx.out);
 }
@@ -434,9 +558,158 @@ void PrintNode(const Node& node, const PrintContext& ctx)
 
 }
 
+Dict::Dict(Storage items) : items_(std::move(items)) 
+{
+    std::sort(items_.begin(), items_.end(), [](const value_type& lhs, const value_type& rhs) 
+    {
+        return lhs.first < rhs.first;
+    });
+
+    auto duplicate = std::adjacent_find(items_.begin(), items_.end(), [](const value_type& lhs, const value_type& rhs) 
+    {
+        return lhs.first == rhs.first;
+    });
+
+    if (duplicate != items_.end()) 
+    {
+        throw ParsingError("Duplicate key '"s + std::string(duplicate->first) + "' have been found");
+    }
+}
+
+Document::Document(Node root, std::shared_ptr<std::pmr::monotonic_buffer_resource> arena) 
+{
+    Node* node = new (arena->allocate(sizeof(Node), alignof(Node))) Node(std::move(root));
+    root_ = std::shared_ptr<const Node>(std::move(arena), node);
+}
+
+TreeHandler::Frame& TreeHandler::PushFrame(bool is_dict) 
+{
+    if (depth_ == stack_.size()) 
+    {
+        stack_.emplace_back();
+    }
+
+    Frame& frame = stack_[depth_++];
+    frame.is_dict = is_dict;
+    return frame;
+}
+
+void TreeHandler::StartDict() 
+{
+    PushFrame(true);
+}
+
+void TreeHandler::Key(std::string_view key) 
+{
+    stack_[depth_ - 1].items.emplace_back(json::String(key, resource_), Node{});
+}
+
+void TreeHandler::EndDict() 
+{
+    Frame& frame = stack_[--depth_];
+    Dict::Storage items(resource_);
+
+    items.reserve(frame.items.size());
+    std::move(frame.items.begin(), frame.items.end(), std::back_inserter(items));
+    frame.items.clear();
+
+    Value(Dict(std::move(items)));
+}
+
+void TreeHandler::StartArray() 
+{
+    PushFrame(false);
+}
+
+void TreeHandler::EndArray() 
+{
+    Frame& frame = stack_[--depth_];
+    Array array(resource_);
+
+    array.reserve(frame.array.size());
+    std::move(frame.array.begin(), frame.array.end(), std::back_inserter(array));
+    frame.array.clear();
+
+    Value(std::move(array));
+}
+
+void TreeHandler::Value(Node value) 
+{
+    if (depth_ == 0) 
+    {
+        root_ = std::move(value);
+        return;
+    }
+
+    Frame& parent = stack_[depth_ - 1];
+
+    if (parent.is_dict) 
+    {
+        parent.items.back().second = std::move(value);
+    } 
+    else 
+    {
+        parent.array.push_back(std::move(value));
+    }
+}
+
+void TreeHandler::String(std::string_view value) 
+{
+    Value(Node(json::String(value, resource_)));
+}
+
+Node TreeHandler::Build() 
+{
+    return std::move(root_);
+}
+
+void Parse(std::string_view input, Handler& handler) 
+{
+    Parser<Handler>(input, handler).ParseNode();
+}
+
+void Parse(std::istream& input, Handler& handler) 
+{
+    Parser<Handler>(input, handler).ParseNode();
+}
+
+Document Load(std::string_view input) 
+{
+    auto arena = std::make_shared<std::pmr::monotonic_buffer_resource>();
+    TreeHandler tree(arena.get());
+    Parser<TreeHandler>(input, tree).ParseNode();
+    return Document{tree.Build(), std::move(arena)};
+}
+
 Document Load(std::istream& input) 
 {
-    return Document{LoadNode(input)};
+    auto arena = std::make_shared<std::pmr::monotonic_buffer_resource>();
+    TreeHandler tree(arena.get());
+    Parser<TreeHandler>(input, tree).ParseNode();
+    return Document{tree.Build(), std::move(arena)};
+}
+
+char* FormatNumber(int value, char* first, char* last) 
+{
+    return std::to_chars(first, last, value).ptr;
+}
+
+char* FormatNumber(double value, char* first, char* last, bool shortest) 
+{
+    return shortest ? std::to_chars(first, last, value).ptr 
+                    : std::to_chars(first, last, value, std::chars_format::general, DEFAULT_PRECISION).ptr;
+}
+
+void PrintNumber(int value, std::ostream& output) 
+{
+    char buffer[32];
+    output.write(buffer, FormatNumber(value, buffer, buffer + sizeof(buffer)) - buffer);
+}
+
+void PrintNumber(double value, std::ostream& output, bool shortest) 
+{
+    char buffer[32];
+    output.write(buffer, FormatNumber(value, buffer, buffer + sizeof(buffer), shortest) - buffer);
 }
 
 void Print(const Document& doc, std::ostream& output) 
@@ -1,16 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace json 
 {
     class Node;
-    using Dict = std::map<std::string, Node>;
-    using Array = std::vector<Node>;
+    using Array = std::pmr::vector<Node>;
+    using String = std::pmr::string;
 
     class ParsingError : public std::runtime_error 
     {
@@ -18,12 +21,62 @@ namespace json
         using runtime_error::runtime_error;
     };
 
-    class Node final : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> 
+    // object stored as one vector of key/value pairs sorted by key; keys must not be
+    // changed through iterators
+    class Dict 
+    {
+    public:
+        using value_type = std::pair<String, Node>;
+        using Storage = std::pmr::vector<value_type>;
+        using iterator = Storage::iterator;
+        using const_iterator = Storage::const_iterator;
+
+        Dict() = default;
+
+        // sorts items by key; a repeated key is a ParsingError
+        explicit Dict(Storage items);
+
+        iterator begin() { return items_.begin(); }
+        iterator end() { return items_.end(); }
+        const_iterator begin() const { return items_.begin(); }
+        const_iterator end() const { return items_.end(); }
+
+        size_t size() const { return items_.size(); }
+        bool empty() const { return items_.empty(); }
+
+        iterator find(std::string_view key);
+        const_iterator find(std::string_view key) const;
+        size_t count(std::string_view key) const;
+
+        Node& at(std::string_view key);
+        const Node& at(std::string_view key) const;
+
+        Node& operator[](std::string_view key);
+
+        std::pair<iterator, bool> try_emplace(std::string_view key, Node value);
+        iterator erase(const_iterator pos);
+
+        bool operator==(const Dict& rhs) const;
+
+    private:
+        iterator LowerBound(std::string_view key);
+        const_iterator LowerBound(std::string_view key) const;
+
+        Storage items_;
+    };
+
+    // containers and strings may live in a document's arena, see Load; copies of a node are
+    // allocated from the default resource
+    class Node final : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, String> 
     {
     public:
         using variant::variant;
         using Value = variant;
 
+        Node(const std::string& value) : variant(String(value)) 
+        {
+        }
+
         bool IsInt() const 
         {
             return std::holds_alternative<int>(*this);
@@ -108,10 +161,10 @@ namespace json
 
         bool IsString() const 
         {
-            return std::holds_alternative<std::string>(*this);
+            return std::holds_alternative<String>(*this);
         }
 
-        const std::string& AsString() const 
+        const String& AsString() const 
         {
             using namespace std::literals;
             if (!IsString()) 
@@ -119,7 +172,7 @@ namespace json
                 throw std::logic_error("Not a string"s);
             }
 
-            return std::get<std::string>(*this);
+            return std::get<String>(*this);
         }
 
         bool IsDict() const 
@@ -165,18 +218,110 @@ namespace json
         return !(lhs == rhs);
     }
 
+    inline Dict::iterator Dict::LowerBound(std::string_view key) 
+    {
+        return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) 
+        {
+            return item.first < key;
+        });
+    }
+
+    inline Dict::const_iterator Dict::LowerBound(std::string_view key) const 
+    {
+        return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) 
+        {
+            return item.first < key;
+        });
+    }
+
+    inline Dict::iterator Dict::find(std::string_view key) 
+    {
+        auto it = LowerBound(key);
+        return it != items_.end() && it->first == key ? it : items_.end();
+    }
+
+    inline Dict::const_iterator Dict::find(std::string_view key) const 
+    {
+        auto it = LowerBound(key);
+        return it != items_.end() && it->first == key ? it : items_.end();
+    }
+
+    inline size_t Dict::count(std::string_view key) const 
+    {
+        return find(key) != items_.end() ? 1 : 0;
+    }
+
+    inline Node& Dict::at(std::string_view key) 
+    {
+        auto it = find(key);
+
+        if (it == items_.end()) 
+        {
+            throw std::out_of_range("No key '" + std::string(key) + "'");
+        }
+        return it->second;
+    }
+
+    inline const Node& Dict::at(std::string_view key) const 
+    {
+        auto it = find(key);
+
+        if (it == items_.end()) 
+        {
+            throw std::out_of_range("No key '" + std::string(key) + "'");
+        }
+        return it->second;
+    }
+
+    inline Node& Dict::operator[](std::string_view key) 
+    {
+        auto it = LowerBound(key);
+
+        if (it == items_.end() || it->first != key) 
+        {
+            it = items_.emplace(it, String(key), Node{});
+        }
+        return it->second;
+    }
+
+    inline std::pair<Dict::iterator, bool> Dict::try_emplace(std::string_view key, Node value) 
+    {
+        auto it = LowerBound(key);
+
+        if (it != items_.end() && it->first == key) 
+        {
+            return {it, false};
+        }
+        return {items_.emplace(it, String(key), std::move(value)), true};
+    }
+
+    inline Dict::iterator Dict::erase(const_iterator pos) 
+    {
+        return items_.erase(pos);
+    }
+
+    inline bool Dict::operator==(const Dict& rhs) const 
+    {
+        return items_ == rhs.items_;
+    }
+
+    // copies share one immutable root
     class Document 
     {
     public:
-        Document(Node root) : root_(std::move(root)) { }
+        Document(Node root) : root_(std::make_shared<const Node>(std::move(root))) { }
+
+        // root must allocate only from arena; the nodes are never destroyed one by one,
+        // the arena is released in a single step with the last copy of the document
+        Document(Node root, std::shared_ptr<std::pmr::monotonic_buffer_resource> arena);
 
         const Node& GetRoot() const 
         {
-            return root_;
+            return *root_;
         }
 
     private:
-        Node root_;
+        std::shared_ptr<const Node> root_;
     };
 
     inline bool operator==(const Document& lhs, const Document& rhs) 
@@ -189,8 +334,86 @@ namespace json
         return !(lhs == rhs);
     }
 
+    // receives parse events in document order; scalars arrive through Value,
+    // strings through String, which by default forwards them to Value
+    class Handler 
+    {
+    public:
+        virtual ~Handler() = default;
+
+        virtual void StartDict() = 0;
+        virtual void Key(std::string_view key) = 0;
+        virtual void EndDict() = 0;
+        virtual void StartArray() = 0;
+        virtual void EndArray() = 0;
+        virtual void Value(Node value) = 0;
+
+        // value is valid only during the call
+        virtual void String(std::string_view value) 
+        {
+            Value(Node(json::String(value)));
+        }
+    };
+
+    // assembles parse events back into a Node. Members of open containers are collected
+    // in reused scratch frames and copied into resource at their exact size when the
+    // container ends; object members are sorted at that point
+    class TreeHandler final : public Handler 
+    {
+    public:
+        explicit TreeHandler(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : resource_(resource) 
+        {
+        }
+
+        void StartDict() override;
+        void Key(std::string_view key) override;
+        void EndDict() override;
+        void StartArray() override;
+        void EndArray() override;
+        void Value(Node value) override;
+        void String(std::string_view value) override;
+
+        Node Build();
+
+    private:
+        struct Frame 
+        {
+            bool is_dict = false;
+            std::vector<Node> array;
+            std::vector<Dict::value_type> items;
+        };
+
+        Frame& PushFrame(bool is_dict);
+
+        std::pmr::memory_resource* resource_;
+        std::vector<Frame> stack_;
+        size_t depth_ = 0;
+        Node root_;
+    };
+
+    // streams one document into handler without building it
+    void Parse(std::string_view input, Handler& handler);
+
+    void Parse(std::istream& input, Handler& handler);
+
+    // the returned document keeps all of its nodes in one arena
+    Document Load(std::string_view input);
+
     Document Load(std::istream& input);
 
+    // significant digits of a double in default output, the same as std::ostream's default
+    inline const int DEFAULT_PRECISION = 6;
+
+    // write the text of value into [first, last) and return its end; 32 chars are always enough
+    char* FormatNumber(int value, char* first, char* last);
+
+    char* FormatNumber(double value, char* first, char* last, bool shortest = false);
+
+    void PrintNumber(int value, std::ostream& output);
+
+    // shortest prints the shortest text that reads back as the same double
+    void PrintNumber(double value, std::ostream& output, bool shortest = false);
+
     void Print(const Document& doc, std::ostream& output);
 
 }  // namespace json
\ No newline at end of file
@@ -1,172 +1,129 @@
 #include "json_builder.h"
 
-#include <cassert>
-
 namespace json
 {
-    KeyContext Builder::Key(std::string key)
+    Builder::Builder() : tree_(std::in_place), target_(*tree_) { }
+
+    Builder::Builder(Handler& target) : target_(target) { }
+
+    KeyContext Builder::Key(std::string_view key)
     {
-        if(nodes_stack_.empty())
+        if(depth_ == 0 || stack_[depth_ - 1] != Open::DICT)
         {
             throw std::logic_error("KeyError");
         }
 
-        if(nodes_stack_.back().get()->IsDict())
-        {
-            nodes_stack_.emplace_back(std::make_unique<Node>(key));
-            return KeyContext(*this);
-        }
-        throw std::logic_error("KeyError");
+        stack_[depth_ - 1] = Open::DICT_KEY;
+        target_.Key(key);
+        return KeyContext(*this);
     }
 
     ValueContext Builder::Value(Node value)
     {
-        if(root_.get() && nodes_stack_.empty())
-        {
-            throw std::logic_error("Value error");
-        }
-
-        if(nodes_stack_.empty())
-        {
-            root_ = std::make_unique<Node>(value);
-            return ValueContext{*this};
-        }
-
-        if(nodes_stack_.back().get()->IsString())
-        {
-            std::string key = nodes_stack_.back().get()->AsString();
-            nodes_stack_.pop_back();
-
-            if(nodes_stack_.back().get()->IsDict())
-            {
-                nodes_stack_.back().get()->AsDict()[key] = value;
-            }
-            else 
-            {
-                throw std::logic_error("Value error");
-            }
-            return ValueContext{*this};
-        }
+        BeforeValue();
+        target_.Value(std::move(value));
+        return ValueContext{*this};
+    }
 
-        if(nodes_stack_.back().get()->IsArray())
-        {
-            nodes_stack_.back().get()->AsArray().emplace_back(value);
-            return ValueContext{*this};
-        }
-        throw std::logic_error("Value error");
+    ValueContext Builder::String(std::string_view value)
+    {
+        BeforeValue();
+        target_.String(value);
+        return ValueContext{*this};
     }
 
     StartArrayContext Builder::StartArray()
     {
-        if(root_.get() && nodes_stack_.empty())
-        {
-            throw std::logic_error("Value error");
-        }
-
-        if(nodes_stack_.empty())
-        {
-            root_ = std::make_unique<Node>(Node(Array{}));
-            nodes_stack_.emplace_back(std::move(root_));
-            return StartArrayContext(*this);
-        }
-
-        if(nodes_stack_.back().get()->IsString() || nodes_stack_.back().get()->IsArray())
-        {
-            nodes_stack_.emplace_back(std::make_unique<Node>(Array{}));
-            return StartArrayContext(*this);
-        }
+        Push(Open::ARRAY);
+        target_.StartArray();
         return StartArrayContext(*this);
     }
 
     EndContext Builder::EndArray()
     {
-        if(nodes_stack_.empty())
-        {
-            throw std::logic_error("Array error");
-        }
+        Pop(Open::ARRAY);
+        target_.EndArray();
+        return EndContext(*this);
+    }
 
-        if(nodes_stack_.back().get()->IsArray())
-        {
-            auto tmp_arr = std::move(nodes_stack_.back());
-            nodes_stack_.pop_back();
+    StartDictContext Builder::StartDict()
+    {
+        Push(Open::DICT);
+        target_.StartDict();
+        return StartDictContext(*this);
+    }
 
-            if(nodes_stack_.size() == 0)
-            {
-                root_ = std::make_unique<Node>(*tmp_arr);
-                return EndContext(*this);
-            }
+    EndContext Builder::EndDict()
+    {
+        Pop(Open::DICT);
+        target_.EndDict();
+        return EndContext(*this);
+    }
 
-            if(nodes_stack_.back().get()->IsString() || nodes_stack_.back().get()->IsArray())
-            {
-                Value(*tmp_arr);
-            }
-            return EndContext(*this);
+    Node Builder::Build()
+    {
+        if(!tree_ || !is_complete_)
+        {
+            throw std::logic_error("error");
         }
-        
-        throw std::logic_error("Array error");
+        return tree_->Build();
     }
 
-    json::StartDictContext Builder::StartDict()
+    // a value is allowed at the root, in an array and after a key
+    void Builder::BeforeValue()
     {
-        if(root_.get() && nodes_stack_.empty())
+        if(depth_ == 0)
         {
-            throw std::logic_error("Value error");
+            if(is_complete_)
+            {
+                throw std::logic_error("Value error");
+            }
+            is_complete_ = true;
+            return;
         }
-        
-        if(nodes_stack_.empty())
+
+        Open& top = stack_[depth_ - 1];
+
+        if(top == Open::DICT)
         {
-            root_ = std::make_unique<Node>(Node(Dict{}));
-            nodes_stack_.emplace_back(std::move(root_));
-            return StartDictContext(*this);
+            throw std::logic_error("Value error");
         }
 
-        if(nodes_stack_.back().get()->IsString() || nodes_stack_.back().get()->IsArray())
+        if(top == Open::DICT_KEY)
         {
-            nodes_stack_.emplace_back(std::make_unique<Node>(Dict{}));
-            return StartDictContext(*this);
+            top = Open::DICT;
         }
-        throw std::logic_error("Dict error");
     }
 
-    EndContext Builder::EndDict()
+    void Builder::Push(Open container)
     {
-        if(nodes_stack_.empty())
+        BeforeValue();
+
+        if(depth_ == MAX_DEPTH)
         {
-            throw std::logic_error("Dict error");
+            throw std::logic_error("nesting is too deep");
         }
 
-        if(nodes_stack_.back().get()->IsDict())
+        // the root is complete only when it is closed
+        if(depth_ == 0)
         {
-            Node* tmp_dict = nodes_stack_.back().release();
-            nodes_stack_.pop_back();
-
-            if(nodes_stack_.empty())
-            {
-                root_ = std::make_unique<Node>(*tmp_dict);
-                return EndContext(*this);
-            }
-
-            if(nodes_stack_.back().get()->IsString() || nodes_stack_.back().get()->IsArray())
-            {
-                Value(*tmp_dict);
-            }
-            return EndContext(*this);
+            is_complete_ = false;
         }
-        throw std::logic_error("Dict error");
+
+        stack_[depth_++] = container;
     }
 
-    Node Builder::Build()
+    void Builder::Pop(Open container)
     {
-        if(!root_.get())
+        if(depth_ == 0 || stack_[depth_ - 1] != container)
         {
-            throw std::logic_error("error");
+            throw std::logic_error(container == Open::ARRAY ? "Array error" : "Dict error");
         }
 
-        if(nodes_stack_.empty())
+        if(--depth_ == 0)
         {
-            return *root_.get();
+            is_complete_ = true;
         }
-        throw std::logic_error("error");
     }
 
     // BaseItemContext
@@ -179,7 +136,13 @@ namespace json
 
     DictValueContext KeyContext::Value(Node value)
     {
-        builder_.Value(value);
+        builder_.Value(std::move(value));
+        return DictValueContext{builder_};
+    }
+
+    DictValueContext KeyContext::String(std::string_view value)
+    {
+        builder_.String(value);
         return DictValueContext{builder_};
     }
 
@@ -206,7 +169,7 @@ namespace json
 
     DictValueContext::DictValueContext(Builder& builder) : BaseItemContext(builder) { }
 
-    KeyContext DictValueContext::Key(std::string key)
+    KeyContext DictValueContext::Key(std::string_view key)
     {
         builder_.Key(key);
         return KeyContext{builder_};
@@ -228,7 +191,13 @@ namespace json
 
     ArrayValueContext& ArrayValueContext::Value(Node value)
     {
-        builder_.Value(value);
+        builder_.Value(std::move(value));
+        return *this;
+    }
+
+    ArrayValueContext& ArrayValueContext::String(std::string_view value)
+    {
+        builder_.String(value);
         return *this;
     }
 
@@ -242,7 +211,7 @@ namespace json
 
     StartDictContext::StartDictContext(Builder& builder) : BaseItemContext(builder) { }
 
-    KeyContext StartDictContext::Key(std::string key)
+    KeyContext StartDictContext::Key(std::string_view key)
     {
         builder_.Key(key);
         return KeyContext{builder_};
@@ -260,7 +229,13 @@ namespace json
 
     ArrayValueContext StartArrayContext::Value(Node value)
     {
-        builder_.Value(value);
+        builder_.Value(std::move(value));
+        return ArrayValueContext{builder_};
+    }
+
+    ArrayValueContext StartArrayContext::String(std::string_view value)
+    {
+        builder_.String(value);
         return ArrayValueContext{builder_};
     }
 
@@ -291,7 +266,7 @@ namespace json
         return builder_.Build();
     }
 
-    KeyContext EndContext::Key(std::string key)
+    KeyContext EndContext::Key(std::string_view key)
     {
         builder_.Key(key);
         return KeyContext{builder_};
@@ -323,7 +298,13 @@ namespace json
 
     ArrayValueContext EndContext::Value(Node value)
     {
-        builder_.Value(value);
+        builder_.Value(std::move(value));
+        return ArrayValueContext{builder_};
+    }
+
+    ArrayValueContext EndContext::String(std::string_view value)
+    {
+        builder_.String(value);
         return ArrayValueContext{builder_};
     }
 }
\ No newline at end of file
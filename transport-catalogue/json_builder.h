@@ -1,8 +1,8 @@
 #pragma once
 
-#include <string>
-#include <deque>
-#include <memory>
+#include <array>
+#include <optional>
+#include <string_view>
 #include "json.h"
 
 namespace json
@@ -16,20 +16,48 @@ namespace json
     class DictValueContext;
     class ArrayValueContext;
 
+    // Checks that calls form one well-formed value and forwards them as events to a handler.
+    // A default-constructed builder assembles a Node returned by Build(); one bound to a
+    // handler such as catalogue::output::JsonWriter streams the value out and builds nothing.
     class Builder
     {
     public:
-        KeyContext Key(std::string key);
+        static const size_t MAX_DEPTH = 64;
+
+        Builder();
+        explicit Builder(Handler& target);
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+
+        KeyContext Key(std::string_view key);
         ValueContext Value(Node value);
+        // as Value, but passes the text on without making a Node of it
+        ValueContext String(std::string_view value);
         StartArrayContext StartArray();
         EndContext EndArray();
         StartDictContext StartDict();
         EndContext EndDict();
+        // only for a builder without a target
         Node Build();
 
     private:
-        std::unique_ptr<Node> root_;
-        std::deque<std::unique_ptr<Node>> nodes_stack_;
+        enum class Open : uint8_t
+        {
+            ARRAY,
+            DICT,
+            // dict whose key has been written and waits for its value
+            DICT_KEY
+        };
+
+        void BeforeValue();
+        void Push(Open container);
+        void Pop(Open container);
+
+        std::optional<TreeHandler> tree_;
+        Handler& target_;
+        std::array<Open, MAX_DEPTH> stack_;
+        size_t depth_ = 0;
+        bool is_complete_ = false;
     };
 
     class BaseItemContext
@@ -47,6 +75,7 @@ namespace json
     public:
         KeyContext(Builder& builder);
         DictValueContext Value(Node value);
+        DictValueContext String(std::string_view value);
         StartDictContext StartDict();
         StartArrayContext StartArray();
     };
@@ -62,7 +91,7 @@ namespace json
     {
     public:
         DictValueContext(Builder& builder);
-        KeyContext Key(std::string key);
+        KeyContext Key(std::string_view key);
         EndContext EndDict();
     };
 
@@ -72,6 +101,7 @@ namespace json
         ArrayValueContext(Builder& builder);
         StartDictContext StartDict();
         ArrayValueContext& Value(Node value); 
+        ArrayValueContext& String(std::string_view value);
         EndContext EndArray(); 
     };
 
@@ -79,7 +109,7 @@ namespace json
     {
     public:
         StartDictContext(Builder& builder);
-        KeyContext Key(std::string key); 
+        KeyContext Key(std::string_view key); 
         EndContext EndDict(); 
     };
 
@@ -88,6 +118,7 @@ namespace json
     public:
         StartArrayContext(Builder& builder);
         ArrayValueContext Value(Node value); 
+        ArrayValueContext String(std::string_view value);
         StartDictContext StartDict();
         StartArrayContext StartArray();
         EndContext EndArray(); 
@@ -97,12 +128,13 @@ namespace json
     {
     public:
         EndContext(Builder& builder);
-        KeyContext Key(std::string key);
+        KeyContext Key(std::string_view key);
         StartDictContext StartDict();
         StartArrayContext StartArray();
         EndContext& EndDict();
         EndContext& EndArray();
         ArrayValueContext Value(Node value);
+        ArrayValueContext String(std::string_view value);
         Node Build();
     };
 }
\ No newline at end of file
@@ -1,9 +1,21 @@
 #include "json_reader.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include <sstream>
 #include <iterator>
 #include <iostream>
 #include <variant>
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cerrno>
+#include <climits>
+#include <functional>
+#include <optional>
 
 using namespace catalogue::input;
 using namespace catalogue::detail;
@@ -14,238 +26,457 @@ namespace catalogue
 {
     namespace input
     {
-        bool JsonReader::Check(std::istream& stream, std::string&& str)
+        // turns parse events of base_requests into catalogue calls; stops are added as
+        // soon as their record ends, buses and distances wait until every stop is known.
+        // Strings are read straight from the parser's buffer, and every stop name a bus or
+        // distance refers to is interned once, so the wait costs one id per reference.
+        // With a request callback, stat_requests following base_requests, render_settings and
+        // routing_settings are handed over one at a time instead of being kept; if any of them
+        // is still missing, the requests are kept and answered at the end of the document
+        class BaseRequestsHandler final : public json::Handler
         {
-            for(const char c : str)
+        public:
+            using RequestCallback = std::function<void(const Node& request, const Dict& sections)>;
+
+            BaseRequestsHandler(TransportCatalogue& catalogue, RequestCallback on_request) 
+                : catalogue_(catalogue), on_request_(std::move(on_request)) {}
+
+            void StartDict() override
             {
-                char tmp;
-                stream >> tmp;
+                StartContainer(&json::Handler::StartDict);
+            }
 
-                if(tmp != c || stream.eof())
+            void StartArray() override
+            {
+                StartContainer(&json::Handler::StartArray);
+            }
+
+            void EndDict() override
+            {
+                if(!tree_ && current_ == Section::BASE && depth_ == RECORD_DEPTH)
                 {
-                    throw ParsingError("false token error");
+                    FlushRecord();
                 }
+
+                EndContainer(&json::Handler::EndDict);
             }
-            return true;
-        }
 
-        Node JsonReader::LoadNode(std::istream& input) 
-        {
-            char c;
-            input >> c;
+            void EndArray() override
+            {
+                EndContainer(&json::Handler::EndArray);
+            }
 
-            switch (c)
+            void Key(std::string_view key) override
             {
-                case '{' :
-                    return LoadDict(input);
-                    break;
+                if(tree_)
+                {
+                    tree_->Key(key);
+                }
+                else if(depth_ == ROOT_DEPTH)
+                {
+                    if(key == "base_requests"sv)
+                    {
+                        current_ = Section::BASE;
+                    }
+                    else if(key == "stat_requests"sv && on_request_ && CanStream())
+                    {
+                        current_ = Section::REQUESTS;
+                    }
+                    else
+                    {
+                        current_ = Section::OTHER;
+                        tree_ = &section_tree_.emplace();
+                        section_key_ = std::string(key);
+                    }
+                }
+                else if(depth_ == RECORD_DEPTH)
+                {
+                    field_.assign(key);
+                }
+                else if(depth_ == RECORD_DEPTH + 1 && field_ == "road_distances"sv)
+                {
+                    distance_to_ = Intern(key);
+                }
+            }
 
-                case '[' :
-                    return LoadArray(input);
-                    break;
+            void String(std::string_view value) override
+            {
+                if(tree_ || current_ != Section::BASE)
+                {
+                    json::Handler::String(value);
+                }
+                else if(depth_ == RECORD_DEPTH)
+                {
+                    if(field_ == "type"sv)
+                    {
+                        record_.type.assign(value);
+                    }
+                    else if(field_ == "name"sv)
+                    {
+                        record_.name.assign(value);
+                    }
+                }
+                else if(depth_ == RECORD_DEPTH + 1 && field_ == "stops"sv)
+                {
+                    record_.stops.push_back(Intern(value));
+                }
+            }
 
-                case '"' :
-                    return LoadString(input);
-                    break;
+            void Value(Node value) override
+            {
+                if(tree_)
+                {
+                    tree_->Value(std::move(value));
 
-                case '0' :
-                case '1' :
-                case '2' :
-                case '3' :
-                case '4' :
-                case '5' :
-                case '6' :
-                case '7' :
-                case '8' :
-                case '9' :
-                case '-' :
-                    input.putback(c);
-                    return LoadNum(input);
-                    break;
+                    if(depth_ == ROOT_DEPTH)
+                    {
+                        FinishSection();
+                    }
+                }
+                else if(current_ == Section::REQUESTS && depth_ == ROOT_DEPTH + 1)
+                {
+                    on_request_(value, sections_);
+                }
+                else if(current_ != Section::BASE)
+                {
+                    return;
+                }
+                else if(depth_ == RECORD_DEPTH)
+                {
+                    SetField(std::move(value));
+                }
+                else if(depth_ == RECORD_DEPTH + 1 && field_ == "road_distances"sv)
+                {
+                    record_.distances.emplace_back(distance_to_, value.AsInt());
+                }
+            }
 
-                case 'f' :
-                    Check(input, "alse");
-                    return Node(false);
-                    break;
+            // returns the sections other than base_requests; stat_requests that came
+            // before the sections they depend on are handed to the callback here
+            Dict Finish()
+            {
+                ResolvePending();
 
-                case 't' :
-                    Check(input, "rue");
-                    return Node(true);
-                    break;
+                auto requests = sections_.find("stat_requests"s);
 
-                case 'n' :
-                    Check(input, "ull");
-                    return Node();
-                    break;
+                if(on_request_ && requests != sections_.end())
+                {
+                    Node stat_requests = std::move(requests->second);
 
-                default:
-                    throw ParsingError("error symbol");
-                    break;
+                    sections_.erase(requests);
+
+                    for(const auto& request : stat_requests.AsArray())
+                    {
+                        on_request_(request, sections_);
+                    }
+                }
+
+                return std::move(sections_);
             }
-            return Node();
-        }
 
-        Node JsonReader::LoadArray(std::istream& in) 
-        {
-            Array result;
+        private:
+            static const int ROOT_DEPTH = 1;
+            static const int RECORD_DEPTH = 3;
 
-            for (char c; in >> c && c != ']';) 
+            enum class Section
             {
-                if(c == '{' || c == '[')
-                {
-                    in.putback(c);
-                    result.push_back(std::move(LoadNode(in)));
-                    continue;
-                }
+                BASE,
+                REQUESTS,
+                OTHER
+            };
 
-                if (c != ',') 
+            // stops and distance targets are ids in referenced_
+            struct Record
+            {
+                std::string type;
+                std::string name;
+                std::optional<double> latitude;
+                std::optional<double> longitude;
+                bool is_roundtrip = false;
+                std::vector<uint32_t> stops;
+                std::vector<std::pair<uint32_t, int>> distances;
+
+                // keeps the buffers for the next record
+                void Clear()
                 {
-                    in.putback(c);
+                    type.clear();
+                    name.clear();
+                    latitude.reset();
+                    longitude.reset();
+                    is_roundtrip = false;
+                    stops.clear();
+                    distances.clear();
                 }
-                result.push_back(std::move(LoadNode(in)));
-            }
+            };
 
-            if(in.eof())
+            struct PendingBus
             {
-                throw ParsingError("eof");
-            }
-            return Node(move(result));
-        }
+                std::string name;
+                std::vector<uint32_t> stops;
+                bool is_roundtrip;
+            };
 
-        Node JsonReader::LoadNum(std::istream& in) 
-        {
-            std::string res;
-            bool is_double = false;
+            struct PendingDistances
+            {
+                uint32_t from;
+                std::vector<std::pair<uint32_t, int>> distances;
+            };
 
-            char next;
-            in >> next;
+            // requests may be answered as they come only when nothing they read can come later
+            bool CanStream() const
+            {
+                return base_done_ && sections_.count("render_settings"s) && sections_.count("routing_settings"s);
+            }
 
-            while(next != ',' && next != ']' && next != '}' && !in.eof())
+            void StartContainer(void (json::Handler::*start)())
             {
-                if(next == '.' || next == 'e' || next == 'E')
+                if(!tree_ && current_ == Section::REQUESTS && depth_ == ROOT_DEPTH + 1)
+                {
+                    tree_ = &request_tree_;
+                }
+
+                if(tree_)
                 {
-                    is_double = true;
+                    (*tree_.*start)();
                 }
-                res += next;
-                in >> next;
+                else if(current_ == Section::BASE && depth_ + 1 == RECORD_DEPTH)
+                {
+                    record_.Clear();
+                }
+
+                ++depth_;
             }
 
-            if(next == ']' || next == '}')
+            void EndContainer(void (json::Handler::*end)())
             {
-                in.putback(next);
+                --depth_;
+
+                if(tree_)
+                {
+                    (*tree_.*end)();
+
+                    if(depth_ == ROOT_DEPTH)
+                    {
+                        FinishSection();
+                    }
+                    else if(current_ == Section::REQUESTS && depth_ == ROOT_DEPTH + 1)
+                    {
+                        on_request_(tree_->Build(), sections_);
+                        tree_ = nullptr;
+                        request_arena_.release();
+                    }
+                }
+                else if(current_ == Section::BASE && depth_ == ROOT_DEPTH)
+                {
+                    ResolvePending();
+                    base_done_ = true;
+                }
             }
 
-            if(is_double)
+            void FinishSection()
             {
-                return Node(std::stod(res));
+                sections_[std::move(section_key_)] = tree_->Build();
+                section_tree_.reset();
+                tree_ = nullptr;
             }
-            return Node(std::stoi(res));
-        }
 
-        Node JsonReader::LoadString(std::istream& in) 
-        {
-            std::string line;
+            uint32_t Intern(std::string_view name)
+            {
+                auto id = referenced_.Find(name);
 
-            char c;
-            c = in.get();
-            
-            while(c != '"')
+                return id ? *id : referenced_.Add(name);
+            }
+
+            void ResolvePending()
             {
-                if(c == '\\')
+                // each referenced name is looked up in the catalogue once
+                std::vector<std::optional<StopId>> resolved(referenced_.size());
+
+                for(uint32_t id = 0; id < referenced_.size(); id++)
+                {
+                    resolved[id] = catalogue_.FindStopId(referenced_[id]);
+                }
+
+                std::vector<std::pair<StopId, int>> distances;
+
+                for(const auto& pending : pending_distances_)
+                {
+                    if(!resolved[pending.from])
+                    {
+                        continue;
+                    }
+
+                    distances.clear();
+
+                    for(const auto& [to, distance] : pending.distances)
+                    {
+                        if(resolved[to])
+                        {
+                            distances.emplace_back(*resolved[to], distance);
+                        }
+                    }
+
+                    catalogue_.AddStopsDistances(*resolved[pending.from], distances);
+                }
+
+                std::vector<StopId> stops;
+
+                for(const auto& bus : pending_buses_)
                 {
-                    c = in.get();
+                    stops.clear();
 
-                    switch (c)
+                    for(uint32_t stop : bus.stops)
                     {
-                    case 'n':
-                        line += '\n';
-                        break;
-
-                    case 't':
-                        line += '\t';
-                        break;
-
-                    case 'r':
-                        line += '\r';
-                        break;
-
-                    case '"':
-                        line += '\"';
-                        break;
-
-                    case '\\':
-                        line += '\\';
-                        break;
-                    
-                    default:
-                        throw ParsingError("error symbol");
-                        break;
+                        if(resolved[stop])
+                        {
+                            stops.push_back(*resolved[stop]);
+                        }
                     }
+
+                    catalogue_.AddRoute(bus.name, stops, bus.is_roundtrip);
+                }
+
+                pending_distances_.clear();
+                pending_distances_.shrink_to_fit();
+                pending_buses_.clear();
+                pending_buses_.shrink_to_fit();
+                referenced_ = detail::NameTable{};
+            }
+
+            void SetField(Node value)
+            {
+                if(field_ == "latitude"sv)
+                {
+                    record_.latitude = value.AsDouble();
                 }
-                else if(c == '\n' || c == '\r')
+                else if(field_ == "longitude"sv)
                 {
-                    throw ParsingError("error n or r");
+                    record_.longitude = value.AsDouble();
                 }
-                else 
+                else if(field_ == "is_roundtrip"sv)
                 {
-                    line += c;
+                    record_.is_roundtrip = value.AsBool();
                 }
+            }
 
-                c = in.get();
+            void FlushRecord()
+            {
+                if(record_.type == "Stop"sv)
+                {
+                    if(!record_.latitude || !record_.longitude)
+                    {
+                        throw std::out_of_range("stop '"s + record_.name + "' has no coordinates"s);
+                    }
 
-                if(in.eof())
+                    catalogue_.AddStop(record_.name, {*record_.latitude, *record_.longitude});
+
+                    if(!record_.distances.empty())
+                    {
+                        pending_distances_.push_back({Intern(record_.name), record_.distances});
+                    }
+                }
+                else if(record_.type == "Bus"sv)
                 {
-                    throw ParsingError("eof");
+                    pending_buses_.push_back({record_.name, record_.stops, record_.is_roundtrip});
                 }
             }
-            return {std::move(line)};
+
+            TransportCatalogue& catalogue_;
+            RequestCallback on_request_;
+            int depth_ = 0;
+            Section current_ = Section::OTHER;
+            bool base_done_ = false;
+
+            Record record_;
+            std::string field_;
+            uint32_t distance_to_ = 0;
+
+            detail::NameTable referenced_;
+            std::vector<PendingBus> pending_buses_;
+            std::vector<PendingDistances> pending_distances_;
+
+            // other top-level sections and single stat requests are assembled as usual;
+            // tree_ points to the one in use
+            json::TreeHandler* tree_ = nullptr;
+            std::optional<json::TreeHandler> section_tree_;
+            // a stat request lives only until its callback returns, so its nodes are taken
+            // from an arena that is reset after every request and rarely outgrows its buffer
+            std::array<std::byte, 4096> request_buffer_;
+            std::pmr::monotonic_buffer_resource request_arena_{request_buffer_.data(), request_buffer_.size()};
+            json::TreeHandler request_tree_{&request_arena_};
+            std::string section_key_;
+            Dict sections_;
+        };
+
+        void JsonReader::Load(std::istream& input) 
+        {
+            document_ = MakeDocument(input);
         }
 
-        Node JsonReader::LoadDict(std::istream& in) 
+        void JsonReader::Load(std::istream& input, TransportCatalogue& catalogue)
         {
-            Dict result;
+            BaseRequestsHandler handler(catalogue, nullptr);
 
-            for (char c; in >> c && c != '}';) 
-            {
-                if (c == ',') 
-                {
-                    in >> c;
-                }
+            json::Parse(input, handler);
 
-                std::string key = LoadString(in).AsString();
+            document_ = Document{handler.Finish()};
+        }
 
-                in >> c;
+        void JsonReader::Load(std::istream& input, TransportCatalogue& catalogue, const RequestCallback& on_request)
+        {
+            size_t published_sections = 0;
 
-                Node node = LoadNode(in);
+            // the callback sees the sections parsed so far, which only grow between requests
+            BaseRequestsHandler handler(catalogue, [&](const Node& request, const Dict& sections)
+            {
+                if(published_sections != sections.size() || document_.GetRoot().IsNull())
+                {
+                    document_ = Document{sections};
+                    published_sections = sections.size();
+                }
 
-                result.emplace(std::move(key), std::move(node));
-            }
+                on_request(request, *this);
+            });
 
-            if(in.eof())
-            {
-                throw ParsingError("eof");
-            }
+            json::Parse(input, handler);
 
-            return Node(move(result));
+            document_ = Document{handler.Finish()};
         }
 
-        void JsonReader::Load(std::istream& input) 
+        Document& JsonReader::Get()
         {
-            document_ = MakeDocument(input);
+            return document_;
         }
 
-        Document& JsonReader::Get()
+        const Document& JsonReader::Get() const
         {
             return document_;
         }
 
-        RenderSetup&& JsonReader::GetRenderSetup() const
+        routing::RoutingSettings JsonReader::GetRoutingSettings() const
+        {
+            routing::RoutingSettings result{};
+
+            if(!document_.GetRoot().AsDict().count("routing_settings"))
+            {
+                return result;
+            }
+
+            const Dict& routing_settings = document_.GetRoot().AsDict().at("routing_settings").AsDict();
+
+            result.bus_wait_time = routing_settings.at("bus_wait_time").AsInt();
+            result.bus_velocity = routing_settings.at("bus_velocity").AsDouble();
+
+            return result;
+        }
+
+        RenderSetup JsonReader::GetRenderSetup() const
         {
-            static RenderSetup result;
+            RenderSetup result{};
 
             if(!document_.GetRoot().AsDict().count("render_settings"))
             {
-                return std::move(result);
+                return result;
             }
             
             Dict render_settings = document_.GetRoot().AsDict().at("render_settings").AsDict();
@@ -276,129 +507,312 @@ namespace catalogue
 
             result.underlayer_color = GetColorFromNode(uc_node);
 
-            return std::move(result);
+            return result;
         }
 
         Document JsonReader::MakeDocument(std::istream& input) 
         {
-            return {LoadNode(input)};
+            return json::Load(input);
         }
     }
 
     namespace output
     {
-        void JsonWriter::Print(const Document& doc, std::ostream& output) 
+        void StreamSink::Write(std::string_view data)
+        {
+            output_.write(data.data(), data.size());
+        }
+
+        void FileSink::Write(std::string_view data)
+        {
+            while(!data.empty())
+            {
+#ifdef _WIN32
+                int written = _write(fd_, data.data(), static_cast<unsigned>(std::min<size_t>(data.size(), INT_MAX)));
+#else
+                ssize_t written = ::write(fd_, data.data(), data.size());
+#endif
+                if(written < 0)
+                {
+                    if(errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw std::runtime_error("cannot write to file descriptor "s + std::to_string(fd_));
+                }
+
+                data.remove_prefix(static_cast<size_t>(written));
+            }
+        }
+
+        void StringSink::Write(std::string_view data)
         {
-            PrintNode(doc.GetRoot(), output);
+            data_.append(data);
         }
 
-        void JsonWriter::Print(Array value, std::ostream& output)
+        const std::string& StringSink::Get() const
         {
-            output << "[";
+            return data_;
+        }
 
-            bool is_first = true;
+        JsonWriter::JsonWriter(Sink& sink, Mode mode, bool shortest_doubles) 
+            : sink_(sink), mode_(mode), shortest_doubles_(shortest_doubles)
+        {
+            buffer_.reserve(BUFFER_SIZE);
+        }
 
-            for(const auto& item : value)
+        void JsonWriter::Print(const Document& doc)
+        {
+            Print(doc.GetRoot());
+        }
+
+        void JsonWriter::Print(const Node& node)
+        {
+            BeforeValue();
+
+            std::visit([this](const auto& value)
             {
-                if(is_first)
-                {
-                    PrintNode(item, output);
+                PrintValue(value);
+            }, node.GetValue());
+        }
 
-                    is_first = false;
+        void JsonWriter::WriteRaw(std::string_view text)
+        {
+            if(buffer_.size() + text.size() > BUFFER_SIZE)
+            {
+                Flush();
 
-                    continue;
+                if(text.size() > BUFFER_SIZE)
+                {
+                    sink_.Write(text);
+                    return;
                 }
+            }
 
-                output << ", ";
+            buffer_.append(text);
+        }
 
-                PrintNode(item, output);
+        void JsonWriter::Flush()
+        {
+            if(!buffer_.empty())
+            {
+                sink_.Write(buffer_);
+                buffer_.clear();
             }
+        }
 
-            output << "]";
+        void JsonWriter::StartDict()
+        {
+            BeforeValue();
+            OpenContainer('{');
         }
-    
-        void JsonWriter::Print(Dict value, std::ostream& output)
+
+        void JsonWriter::Key(std::string_view key)
         {
-            output << "{";
+            if(item_counts_.empty() || after_key_)
+            {
+                throw std::logic_error("key outside of a dict");
+            }
 
-            bool is_first = true;
+            PrintSeparator(item_counts_.back()++);
+            PrintString(key);
+            WriteRaw(mode_ == Mode::PRETTY ? ": "sv : ":"sv);
 
-            for (auto [key, val] : value)
-            {
-                if(is_first)
-                {
-                    output << "\"" << key << "\"" << ":";
+            after_key_ = true;
+        }
 
-                    PrintNode(val, output);
+        void JsonWriter::EndDict()
+        {
+            CloseContainer('}');
+        }
 
-                    is_first = false;
+        void JsonWriter::StartArray()
+        {
+            BeforeValue();
+            OpenContainer('[');
+        }
 
-                    continue;
-                }
+        void JsonWriter::EndArray()
+        {
+            CloseContainer(']');
+        }
 
-                output << ", ";
+        void JsonWriter::Value(Node value)
+        {
+            Print(value);
+        }
 
-                output << "\"" << key << "\"" << ":";
+        void JsonWriter::String(std::string_view value)
+        {
+            BeforeValue();
+            PrintString(value);
+        }
 
-                PrintNode(val, output);
-            }
+        void JsonWriter::PrintValue(std::nullptr_t)
+        {
+            WriteRaw("null"sv);
+        }
+
+        void JsonWriter::PrintValue(bool value)
+        {
+            WriteRaw(value ? "true"sv : "false"sv);
+        }
 
-            output << "}";
+        void JsonWriter::PrintValue(int value)
+        {
+            char text[32];
+            WriteRaw(std::string_view(text, json::FormatNumber(value, text, text + sizeof(text)) - text));
         }
 
-        void JsonWriter::Print(std::nullptr_t, std::ostream& output)
+        void JsonWriter::PrintValue(double value)
         {
-            output << "null";
+            char text[32];
+            WriteRaw(std::string_view(text, json::FormatNumber(value, text, text + sizeof(text), shortest_doubles_) - text));
+        }
+
+        void JsonWriter::PrintValue(const json::String& value)
+        {
+            PrintString(value);
+        }
+
+        void JsonWriter::PrintValue(const Array& value)
+        {
+            OpenContainer('[');
+
+            for(const Node& item : value)
+            {
+                Print(item);
+            }
+
+            CloseContainer(']');
         }
 
-        void JsonWriter::Print(bool value, std::ostream& output)
+        void JsonWriter::PrintValue(const Dict& value)
         {
-            output << (value ? "true" : "false");
+            OpenContainer('{');
+
+            for(const auto& [key, item] : value)
+            {
+                Key(key);
+                Print(item);
+            }
+
+            CloseContainer('}');
         }
 
-        void JsonWriter::Print(std::string value, std::ostream& output)
+        void JsonWriter::PrintString(std::string_view value)
         {
-            std::string res;
+            WriteRaw("\""sv);
+
+            // unescaped runs are written in one piece
+            size_t begin = 0;
 
-            for(const char c : value)
+            for(size_t i = 0; i < value.size(); i++)
             {
-                switch (c)
+                std::string_view escaped;
+
+                switch(value[i])
                 {
                 case '\n':
-                    res += "\\n";
+                    escaped = "\\n"sv;
                     break;
 
                 case '\r':
-                    res += "\\r";
-                    break;
-
-                case '\t':
-                    res += "\t";
+                    escaped = "\\r"sv;
                     break;
 
                 case '\"':
-                    res += "\\\"";
+                    escaped = "\\\""sv;
                     break;
 
                 case '\\':
-                    res += "\\\\";
+                    escaped = "\\\\"sv;
                     break;
-                
+
                 default:
-                    res += c;
-                    break;
+                    continue;
                 }
+
+                WriteRaw(value.substr(begin, i - begin));
+                WriteRaw(escaped);
+                begin = i + 1;
             }
 
-            output << "\"" << res << "\"";
+            WriteRaw(value.substr(begin));
+            WriteRaw("\""sv);
         }
 
-        void JsonWriter::PrintNode(const Node& node, std::ostream& output)
+        void JsonWriter::BeforeValue()
         {
-            std::visit([&](const auto& value)
+            if(after_key_)
             {
-                Print(value, output);
-            }, node.GetValue());
+                after_key_ = false;
+                return;
+            }
+
+            if(!item_counts_.empty())
+            {
+                PrintSeparator(item_counts_.back()++);
+            }
+        }
+
+        void JsonWriter::OpenContainer(char bracket)
+        {
+            WriteRaw(std::string_view(&bracket, 1));
+
+            ++indent_;
+
+            item_counts_.push_back(0);
+        }
+
+        void JsonWriter::CloseContainer(char bracket)
+        {
+            if(item_counts_.empty() || after_key_)
+            {
+                throw std::logic_error("unbalanced container end");
+            }
+
+            bool is_empty = item_counts_.back() == 0;
+
+            item_counts_.pop_back();
+
+            --indent_;
+
+            PrintClosing(bracket, is_empty);
+        }
+
+        void JsonWriter::PrintSeparator(size_t index)
+        {
+            if(mode_ == Mode::COMPACT)
+            {
+                if(index > 0)
+                {
+                    WriteRaw(", "sv);
+                }
+                return;
+            }
+
+            WriteRaw(index > 0 ? ",\n"sv : "\n"sv);
+
+            for(int i = 0; i < indent_; i++)
+            {
+                WriteRaw("    "sv);
+            }
+        }
+
+        void JsonWriter::PrintClosing(char bracket, bool is_empty)
+        {
+            if(mode_ == Mode::PRETTY && !is_empty)
+            {
+                WriteRaw("\n"sv);
+
+                for(int i = 0; i < indent_; i++)
+                {
+                    WriteRaw("    "sv);
+                }
+            }
+
+            WriteRaw(std::string_view(&bracket, 1));
         }
     }
 
@@ -433,7 +847,7 @@ namespace catalogue
 
             if(node.IsString())
             {
-                tmp = node.AsString();
+                tmp = std::string(node.AsString());
             }
             else
             {
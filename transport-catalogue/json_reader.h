@@ -1,12 +1,15 @@
 #pragma once
 
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <istream>
 #include "json.h"
 #include "geo.h"
 #include "map_renderer.h"
 #include "transport_catalogue.h"
+#include "transport_router.h"
 
 using namespace json;
 using namespace catalogue::render;
@@ -18,48 +21,136 @@ namespace catalogue
         class JsonReader
         {
         public: 
-            JsonReader() = default;
+            using RequestCallback = std::function<void(const Node& request, const JsonReader& reader)>;
+
+            JsonReader() : document_(Node{}) {}
             JsonReader(std::istream& input) : document_(std::move(MakeDocument(input))){}
+            JsonReader(std::istream& input, TransportCatalogue& catalogue) : document_(Node{}) { Load(input, catalogue); }
             void Load(std::istream& input);
+            // feeds base_requests into catalogue while parsing; only the other sections are kept in the document
+            void Load(std::istream& input, TransportCatalogue& catalogue);
+            // as above, but stat_requests are passed to on_request one by one and not kept; they are passed
+            // while parsing if base_requests, render_settings and routing_settings all come before them,
+            // and after the whole document otherwise. The reader given to on_request holds the sections
+            // parsed so far
+            void Load(std::istream& input, TransportCatalogue& catalogue, const RequestCallback& on_request);
             Document& Get();
-            RenderSetup&& GetRenderSetup() const;
+            const Document& Get() const;
+            RenderSetup GetRenderSetup() const;
+            routing::RoutingSettings GetRoutingSettings() const;
 
         private:
 
             Document MakeDocument(std::istream& input);
-            bool Check(std::istream& stream, std::string&& str);
-            Node LoadNode(std::istream& input);
-            Node LoadArray(std::istream& in);
-            Node LoadNum(std::istream& in);
-            Node LoadString(std::istream& in);
-            Node LoadDict(std::istream& in);
             Document document_;
         };
     }
 
     namespace output
     {
-        class JsonWriter
+        // destination of serialized bytes
+        class Sink
+        {
+        public:
+            virtual ~Sink() = default;
+            virtual void Write(std::string_view data) = 0;
+        };
+
+        class StreamSink final : public Sink
         {
         public:
-            void Print(const Document& doc, std::ostream& output);
+            explicit StreamSink(std::ostream& output) : output_(output) {}
+            void Write(std::string_view data) override;
 
         private:
-            template<typename T>
-            void Print(const T& value, std::ostream& output)
-            {
-                output << value;
-            }
-
-            void Print(std::nullptr_t, std::ostream& output);
-            void Print(bool value, std::ostream& output);
-            void Print(std::string value, std::ostream& output);
-            void Print(Array value, std::ostream& output);
-            void Print(Dict value, std::ostream& output);
-            void PrintNode(const Node& node, std::ostream& output);
+            std::ostream& output_;
+        };
+
+        // writes to an open file descriptor, which stays owned by the caller
+        class FileSink final : public Sink
+        {
+        public:
+            explicit FileSink(int fd) : fd_(fd) {}
+            void Write(std::string_view data) override;
+
+        private:
+            int fd_;
+        };
+
+        class StringSink final : public Sink
+        {
+        public:
+            void Write(std::string_view data) override;
+            const std::string& Get() const;
+
+        private:
+            std::string data_;
         };
 
-        
+        // Serializes nodes into a reusable buffer and hands it to the sink in chunks of about
+        // BUFFER_SIZE bytes; values longer than that skip the buffer. Call Flush() when done,
+        // the destructor does not write.
+        // As a json::Handler it also takes a document token by token, e.g. from a streaming
+        // json::Builder; separators and indentation are then tracked by the writer. Value
+        // accepts whole containers as well as scalars.
+        class JsonWriter final : public json::Handler
+        {
+        public:
+            enum class Mode
+            {
+                // one line, ", " between items and no space after ':' as in our responses
+                COMPACT,
+                // one item per line, indented by four spaces
+                PRETTY
+            };
+
+            static const size_t BUFFER_SIZE = 1 << 16;
+
+            // doubles get json::DEFAULT_PRECISION significant digits unless shortest_doubles is set,
+            // then the shortest text that reads back exactly
+            explicit JsonWriter(Sink& sink, Mode mode = Mode::COMPACT, bool shortest_doubles = false);
+
+            void Print(const Document& doc);
+            void Print(const Node& node);
+            // copies text to the output as is
+            void WriteRaw(std::string_view text);
+            void Flush();
+
+            void StartDict() override;
+            void Key(std::string_view key) override;
+            void EndDict() override;
+            void StartArray() override;
+            void EndArray() override;
+            void Value(Node value) override;
+            void String(std::string_view value) override;
+
+        private:
+            void PrintValue(std::nullptr_t);
+            void PrintValue(bool value);
+            void PrintValue(int value);
+            void PrintValue(double value);
+            void PrintValue(const json::String& value);
+            void PrintValue(const Array& value);
+            void PrintValue(const Dict& value);
+
+            void PrintString(std::string_view value);
+            // writes the separator a value needs in the innermost open container
+            void BeforeValue();
+            void OpenContainer(char bracket);
+            void CloseContainer(char bracket);
+            // separator before the item with the given index of a container at the current indent
+            void PrintSeparator(size_t index);
+            void PrintClosing(char bracket, bool is_empty);
+
+            Sink& sink_;
+            Mode mode_;
+            bool shortest_doubles_;
+            int indent_ = 0;
+            std::string buffer_;
+            // number of items written so far to each open container, innermost last
+            std::vector<size_t> item_counts_;
+            bool after_key_ = false;
+        };
     }
     
     namespace detail
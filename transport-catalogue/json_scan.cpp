@@ -0,0 +1,280 @@
+#include "json_scan.h"
+
+#include <atomic>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JSON_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define JSON_SCAN_TARGET_AVX2
+#else
+#define JSON_SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace json {
+namespace scan {
+
+namespace {
+
+bool IsStringEnd(char c) 
+{
+    return c == '"' || c == '\\' || c == '\n' || c == '\r';
+}
+
+bool IsWhitespace(char c) 
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool IsNumberChar(char c) 
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+const char* FindStringEndScalar(const char* first, const char* last) 
+{
+    while (first != last && !IsStringEnd(*first)) 
+    {
+        ++first;
+    }
+    return first;
+}
+
+const char* SkipWhitespaceScalar(const char* first, const char* last) 
+{
+    while (first != last && IsWhitespace(*first)) 
+    {
+        ++first;
+    }
+    return first;
+}
+
+const char* FindNumberEndScalar(const char* first, const char* last) 
+{
+    while (first != last && IsNumberChar(*first)) 
+    {
+        ++first;
+    }
+    return first;
+}
+
+const Scanners SCALAR_SCANNERS{FindStringEndScalar, SkipWhitespaceScalar, FindNumberEndScalar};
+
+#ifdef JSON_SCAN_X86
+
+unsigned CountTrailingZeros(unsigned mask) 
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Each block scanner computes a bit mask of the bytes that end the run, one bit per byte,
+// and stops at the lowest set bit. The tail shorter than a block is left to the scalar loop
+
+__m128i StringEndMask(__m128i bytes) 
+{
+    return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'))),
+                        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+}
+
+__m128i WhitespaceMask(__m128i bytes) 
+{
+    return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))),
+                        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))));
+}
+
+// bytes from 0x80 up compare as negative, so they never pass for digits
+__m128i NumberCharMask(__m128i bytes) 
+{
+    __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8('9' + 1)));
+    __m128i signs = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('-')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('+')));
+    __m128i other = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('.')), 
+                                 _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('e')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('E'))));
+    return _mm_or_si128(digits, _mm_or_si128(signs, other));
+}
+
+// invert is set for masks of bytes that continue the run
+template <__m128i (*Mask)(__m128i), bool invert, ScanFunction tail>
+const char* ScanSse2(const char* first, const char* last) 
+{
+    while (last - first >= 16) 
+    {
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(Mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)))));
+
+        if (invert) 
+        {
+            mask = ~mask & 0xFFFFu;
+        }
+
+        if (mask != 0) 
+        {
+            return first + CountTrailingZeros(mask);
+        }
+        first += 16;
+    }
+    return tail(first, last);
+}
+
+const Scanners SSE2_SCANNERS{
+    ScanSse2<StringEndMask, false, FindStringEndScalar>,
+    ScanSse2<WhitespaceMask, true, SkipWhitespaceScalar>,
+    ScanSse2<NumberCharMask, true, FindNumberEndScalar>
+};
+
+JSON_SCAN_TARGET_AVX2 __m256i StringEndMaskAvx2(__m256i bytes) 
+{
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\'))),
+                           _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r'))));
+}
+
+JSON_SCAN_TARGET_AVX2 __m256i WhitespaceMaskAvx2(__m256i bytes) 
+{
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))),
+                           _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))));
+}
+
+JSON_SCAN_TARGET_AVX2 __m256i NumberCharMaskAvx2(__m256i bytes) 
+{
+    __m256i digits = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), bytes));
+    __m256i signs = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('-')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('+')));
+    __m256i other = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('.')), 
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('e')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('E'))));
+    return _mm256_or_si256(digits, _mm256_or_si256(signs, other));
+}
+
+// Keys, names and numbers rarely exceed 32 bytes, and for them two 16-byte blocks are
+// cheaper than a 32-byte one; only a longer run goes on in 32-byte blocks
+template <__m128i (*Mask)(__m128i), __m256i (*Mask32)(__m256i), bool invert, ScanFunction tail>
+JSON_SCAN_TARGET_AVX2 const char* ScanAvx2(const char* first, const char* last) 
+{
+    for (int i = 0; i < 2 && last - first >= 16; i++) 
+    {
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(Mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)))));
+
+        if (invert) 
+        {
+            mask = ~mask & 0xFFFFu;
+        }
+
+        if (mask != 0) 
+        {
+            return first + CountTrailingZeros(mask);
+        }
+        first += 16;
+    }
+
+    while (last - first >= 32) 
+    {
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(Mask32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)))));
+
+        if (invert) 
+        {
+            mask = ~mask;
+        }
+
+        if (mask != 0) 
+        {
+            return first + CountTrailingZeros(mask);
+        }
+        first += 32;
+    }
+    return tail(first, last);
+}
+
+const Scanners AVX2_SCANNERS{
+    ScanAvx2<StringEndMask, StringEndMaskAvx2, false, ScanSse2<StringEndMask, false, FindStringEndScalar>>,
+    ScanAvx2<WhitespaceMask, WhitespaceMaskAvx2, true, ScanSse2<WhitespaceMask, true, SkipWhitespaceScalar>>,
+    ScanAvx2<NumberCharMask, NumberCharMaskAvx2, true, ScanSse2<NumberCharMask, true, FindNumberEndScalar>>
+};
+
+bool CpuHasAvx2() 
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+
+    if (info[0] < 7) 
+    {
+        return false;
+    }
+
+    __cpuid(info, 1);
+
+    // the OS must save the ymm registers: OSXSAVE set and XCR0 enabling SSE and AVX state
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) 
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+const Scanners& GetScanners(Level level) 
+{
+#ifdef JSON_SCAN_X86
+    switch (level) 
+    {
+        case Level::AVX2:
+            return AVX2_SCANNERS;
+
+        case Level::SSE2:
+            return SSE2_SCANNERS;
+
+        default:
+            break;
+    }
+#endif
+    return SCALAR_SCANNERS;
+}
+
+std::atomic<Level> current_level{GetSupportedLevel()};
+std::atomic<const Scanners*> current_scanners{&GetScanners(current_level.load())};
+
+}
+
+Level GetSupportedLevel() 
+{
+#ifdef JSON_SCAN_X86
+    return CpuHasAvx2() ? Level::AVX2 : Level::SSE2;
+#else
+    return Level::SCALAR;
+#endif
+}
+
+Level GetLevel() 
+{
+    return current_level.load();
+}
+
+void SetLevel(Level level) 
+{
+    if (static_cast<int>(level) > static_cast<int>(GetSupportedLevel())) 
+    {
+        throw std::invalid_argument("scan level is not supported here");
+    }
+
+    current_level = level;
+    current_scanners = &GetScanners(level);
+}
+
+const Scanners& GetScanners() 
+{
+    return *current_scanners.load();
+}
+
+}
+}
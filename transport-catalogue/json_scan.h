@@ -0,0 +1,42 @@
+#pragma once
+
+namespace json 
+{
+    // Byte scanners used by the parser. Each returns the first position in [first, last)
+    // that does not belong to the run, or last. On x86 they look at 16 (SSE2) or 32 (AVX2)
+    // bytes at a time, picked once at startup from what the CPU supports; every level
+    // returns the same positions as the scalar one.
+    namespace scan 
+    {
+        enum class Level 
+        {
+            SCALAR,
+            SSE2,
+            AVX2
+        };
+
+        // the best level this build and CPU support
+        Level GetSupportedLevel();
+
+        Level GetLevel();
+
+        // switches every scanner to level, which must not exceed GetSupportedLevel();
+        // meant for tests and benchmarks, not for use while anything is being parsed
+        void SetLevel(Level level);
+
+        using ScanFunction = const char* (*)(const char* first, const char* last);
+
+        struct Scanners 
+        {
+            // stops at '"', '\\', '\n' or '\r'
+            ScanFunction find_string_end;
+            // stops at the first byte other than ' ', '\n', '\r' or '\t'
+            ScanFunction skip_whitespace;
+            // stops at the first byte that is not a digit, '-', '+', '.', 'e' or 'E'
+            ScanFunction find_number_end;
+        };
+
+        // scanners of the current level; a parser fetches them once and calls them directly
+        const Scanners& GetScanners();
+    }
+}
@@ -0,0 +1,64 @@
+#include <atomic>
+#include <stdexcept>
+#include "live_catalogue.h"
+
+namespace catalogue
+{
+    LiveCatalogue::LiveCatalogue(TransportCatalogue draft) : draft_(std::move(draft))
+    {
+        if(draft_.IsFrozen())
+        {
+            throw std::invalid_argument("live catalogue needs an unfrozen draft");
+        }
+
+        draft_.BuildIndexes();
+
+        auto first = std::make_shared<TransportCatalogue>(draft_);
+        first->Freeze();
+
+        std::atomic_store(&current_, std::shared_ptr<const TransportCatalogue>(std::move(first)));
+    }
+
+    std::shared_ptr<const TransportCatalogue> LiveCatalogue::Get() const
+    {
+        return std::atomic_load(&current_);
+    }
+
+    void LiveCatalogue::AddRoute(std::string route_name, std::vector<std::string> stop_names, bool is_circular)
+    {
+        Update([&](TransportCatalogue& next)
+        {
+            next.AddRoute(std::move(route_name), std::move(stop_names), is_circular);
+        });
+    }
+
+    void LiveCatalogue::SetDistance(std::string_view from, std::string_view to, int distance)
+    {
+        Update([&](TransportCatalogue& next)
+        {
+            next.AddStopsDistances(from, {{std::string(to), distance}});
+        });
+    }
+
+    void LiveCatalogue::CloseStop(std::string_view name)
+    {
+        Update([&](TransportCatalogue& next)
+        {
+            next.CloseStop(name);
+        });
+    }
+
+    // called with update_mutex_ held
+    void LiveCatalogue::Publish(TransportCatalogue&& next)
+    {
+        // indexes are rebuilt on the draft, so the published copy shares them and needs no work to freeze
+        next.BuildIndexes();
+
+        draft_ = std::move(next);
+
+        auto published = std::make_shared<TransportCatalogue>(draft_);
+        published->Freeze();
+
+        std::atomic_store(&current_, std::shared_ptr<const TransportCatalogue>(std::move(published)));
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include "transport_catalogue.h"
+
+namespace catalogue
+{
+    // Serves a frozen TransportCatalogue to readers while writers publish new versions.
+    // A reader pins the current version with Get() and keeps using it for as long as it
+    // holds the pointer; an update copies the writable draft, applies the change, freezes
+    // the copy and swaps it in atomically. A replaced version is destroyed when its last
+    // reader lets go, so updates never wait for readers and readers never wait for updates.
+    // Versions share the parts of the catalogue an update leaves alone: a new route copies
+    // the route table and rebuilds the stop to bus index, a distance copies the distances
+    // and rebuilds their table, and only the stats of the buses concerned are recomputed.
+    class LiveCatalogue
+    {
+    public:
+
+        // draft must not be frozen: later updates are applied on top of its build-time data
+        explicit LiveCatalogue(TransportCatalogue draft);
+
+        std::shared_ptr<const TransportCatalogue> Get() const;
+
+        // apply receives a writable copy of the latest draft, sharing its storage until changed;
+        // if it throws, nothing is published
+        template<typename F>
+        void Update(F apply);
+
+        void AddRoute(std::string route_name, std::vector<std::string> stop_names, bool is_circular);
+
+        void SetDistance(std::string_view from, std::string_view to, int distance);
+
+        void CloseStop(std::string_view name);
+
+    private:
+
+        void Publish(TransportCatalogue&& next);
+
+        std::mutex update_mutex_;
+        TransportCatalogue draft_;
+        std::shared_ptr<const TransportCatalogue> current_;
+    };
+
+    template<typename F>
+    void LiveCatalogue::Update(F apply)
+    {
+        std::lock_guard<std::mutex> lock(update_mutex_);
+
+        TransportCatalogue next = draft_;
+
+        apply(next);
+
+        Publish(std::move(next));
+    }
+}
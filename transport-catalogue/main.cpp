@@ -21,15 +21,16 @@ int main()
     TransportCatalogue catalogue;    
 
     std::fstream fs(current_path().string() + "/s10_final_opentest_2.json");
-    JsonReader jr(fs);
+
+    RequestHandler rh(catalogue);
+
+    rh.ProcessStream(fs, std::cout);
 
     fs.close();
 
     //JsonReader jr(std::cin);
 
-    RequestHandler rh(catalogue);
-
-    rh.FillCatalogueFromJson(jr);
+    //rh.FillCatalogueFromJson(jr);
 
     //std::fstream fs_out(current_path().string() + "/map_test_out.json");
 
@@ -39,7 +40,5 @@ int main()
 
     //fs_out.close();
 
-    rh.PrintResponse(jr, std::cout);
-
     std::cout << "1";
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <set>
 #include "map_renderer.h"
 
@@ -24,18 +25,24 @@ namespace catalogue
             throw std::invalid_argument("invalid color palette id");
         }
 
-        void Renderer::AddRoute(const std::string_view name, const std::vector<const Stop*> stops, bool is_roundtrip)
+        void Renderer::AddRoute(const std::string_view name, std::vector<Stop> stops, bool is_roundtrip)
         {
-            routes_[std::string(name)] = std::pair<std::vector<const Stop*>, bool>(stops, is_roundtrip);
+            routes_[std::string(name)] = std::pair<std::vector<Stop>, bool>(std::move(stops), is_roundtrip);
         }
 
-        svg::Text&& Renderer::GetRouteUnderlayerText(std::string route_name, const Stop* stop) const
+        void Renderer::SetIsochrone(std::vector<std::pair<Stop, double>> stops, double time_budget)
         {
-            static svg::Text bus_text_underlayer;
+            isochrone_ = std::move(stops);
+            isochrone_budget_ = time_budget;
+        }
+
+        svg::Text Renderer::GetRouteUnderlayerText(std::string route_name, const Stop& stop) const
+        {
+            svg::Text bus_text_underlayer;
             bus_text_underlayer.SetData(route_name);
             bus_text_underlayer.SetFontSize(setup_.bus_label_font_size);
             bus_text_underlayer.SetFontFamily("Verdana");
-            bus_text_underlayer.SetPosition(sphere_projector_(stop->coordinates_));
+            bus_text_underlayer.SetPosition(sphere_projector_(stop.coordinates_));
             bus_text_underlayer.SetOffset(setup_.bus_label_offset);
             bus_text_underlayer.SetFontWeight("bold");
             bus_text_underlayer.SetFillColor(setup_.underlayer_color);
@@ -44,30 +51,30 @@ namespace catalogue
             bus_text_underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
             bus_text_underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
-            return std::move(bus_text_underlayer);
+            return bus_text_underlayer;
         }
 
-        svg::Text&& Renderer::GetRouteText(std::string route_name, svg::Color color, const Stop* stop) const
+        svg::Text Renderer::GetRouteText(std::string route_name, svg::Color color, const Stop& stop) const
         {        
-            static svg::Text bus_text;
+            svg::Text bus_text;
             bus_text.SetData(route_name);
             bus_text.SetFontSize(setup_.bus_label_font_size);
             bus_text.SetFontFamily("Verdana");
-            bus_text.SetPosition(sphere_projector_(stop->coordinates_));
+            bus_text.SetPosition(sphere_projector_(stop.coordinates_));
             bus_text.SetOffset(setup_.bus_label_offset);
             bus_text.SetFontWeight("bold");
             bus_text.SetFillColor(color);
 
-            return std::move(bus_text);
+            return bus_text;
         }
 
-        svg::Text&& Renderer::GetStopUnderlayerText(const Stop* stop) const
+        svg::Text Renderer::GetStopUnderlayerText(const Stop& stop) const
         {
-            static svg::Text stop_text_underlayer;
-            stop_text_underlayer.SetData(stop->name_);
+            svg::Text stop_text_underlayer;
+            stop_text_underlayer.SetData(std::string(stop.name_));
             stop_text_underlayer.SetFontSize(setup_.stop_label_font_size);
             stop_text_underlayer.SetFontFamily("Verdana");
-            stop_text_underlayer.SetPosition(sphere_projector_(stop->coordinates_));
+            stop_text_underlayer.SetPosition(sphere_projector_(stop.coordinates_));
             stop_text_underlayer.SetOffset(setup_.stop_label_offset);
             stop_text_underlayer.SetFillColor(setup_.underlayer_color);
             stop_text_underlayer.SetStrokeColor(setup_.underlayer_color);
@@ -75,20 +82,20 @@ namespace catalogue
             stop_text_underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
             stop_text_underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
-            return std::move(stop_text_underlayer);
+            return stop_text_underlayer;
         }
 
-        svg::Text&& Renderer::GetStopText(svg::Color color, const Stop* stop) const
+        svg::Text Renderer::GetStopText(svg::Color color, const Stop& stop) const
         {
-            static svg::Text stop_text;
-            stop_text.SetData(stop->name_);
+            svg::Text stop_text;
+            stop_text.SetData(std::string(stop.name_));
             stop_text.SetFontSize(setup_.stop_label_font_size);
             stop_text.SetFontFamily("Verdana");
-            stop_text.SetPosition(sphere_projector_(stop->coordinates_));
+            stop_text.SetPosition(sphere_projector_(stop.coordinates_));
             stop_text.SetOffset(setup_.stop_label_offset);
             stop_text.SetFillColor(color);
 
-            return std::move(stop_text);
+            return stop_text;
         }
 
         void Renderer::Render(std::ostream& stream) const
@@ -100,19 +107,19 @@ namespace catalogue
 
             int current_color_id = 0;
 
-            std::map<std::string_view, const Stop*> stops_list;
+            std::map<std::string_view, Stop> stops_list;
 
             for(const auto& [name, stops] : routes_)
             {
                 svg::Polyline line;
 
-                for(const auto stop : stops.first)
+                for(const auto& stop : stops.first)
                 {
-                    svg::Point coords = sphere_projector_(stop->coordinates_);
+                    svg::Point coords = sphere_projector_(stop.coordinates_);
 
                     line.AddPoint(coords);
 
-                    stops_list[std::string_view(stop->name_)] = stop;
+                    stops_list[stop.name_] = stop;
                 }
 
                 if(!stops.first.empty())
@@ -128,7 +135,7 @@ namespace catalogue
 
                         int id = stop_count / 2 + (stop_count - (stop_count / 2) * 2);
 
-                        if(stops.first[0] != stops.first[id])
+                        if(stops.first[0].id_ != stops.first[id].id_)
                         {
                             bus_texts.push_back(GetRouteUnderlayerText(name, stops.first[id]));
                             bus_texts.push_back(GetRouteText(name, color, stops.first[id]));
@@ -145,10 +152,10 @@ namespace catalogue
                 }                 
             }
 
-            for(const auto [name, stop] : stops_list)
+            for(const auto& [name, stop] : stops_list)
             {
                 svg::Circle circle;
-                circle.SetCenter(sphere_projector_(stop->coordinates_));
+                circle.SetCenter(sphere_projector_(stop.coordinates_));
                 circle.SetRadius(setup_.stop_radius);
                 circle.SetFillColor("white");
 
@@ -168,6 +175,24 @@ namespace catalogue
                 doc.Add(c);
             }
 
+            if(!isochrone_.empty() && setup_.color_palette.empty())
+            {
+                throw std::invalid_argument("isochrone needs a color palette");
+            }
+
+            for(const auto& [stop, time] : isochrone_)
+            {
+                // the palette is split into equal bands of the budget
+                size_t band = isochrone_budget_ > 0 ? static_cast<size_t>(time / isochrone_budget_ * setup_.color_palette.size()) : 0;
+
+                svg::Circle circle;
+                circle.SetCenter(sphere_projector_(stop.coordinates_));
+                circle.SetRadius(setup_.stop_radius);
+                circle.SetFillColor(setup_.color_palette[std::min(band, setup_.color_palette.size() - 1)]);
+
+                doc.Add(circle);
+            }
+
             for(auto& t : stop_texts)
             {
                 doc.Add(t);
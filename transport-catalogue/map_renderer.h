@@ -35,19 +35,24 @@ namespace catalogue
         public:
 
             Renderer(RenderSetup&& setup, SphereProjector&& sphere_projector) : setup_(setup), sphere_projector_(sphere_projector) {}
-            void AddRoute(const std::string_view name, const std::vector<const Stop*> stops, bool is_roundtrip);
+            void AddRoute(const std::string_view name, std::vector<Stop> stops, bool is_roundtrip);
+            // stops reached within time_budget minutes, drawn over the stop circles in the colour
+            // of their share of the budget: the first palette colour for the nearest ones
+            void SetIsochrone(std::vector<std::pair<Stop, double>> stops, double time_budget);
             void Render(std::ostream& stream) const;
 
         private:
 
-            svg::Text&& GetRouteUnderlayerText(std::string route_name, const Stop* stop) const;
-            svg::Text&& GetRouteText(std::string route_name, svg::Color color, const Stop* stop) const;
-            svg::Text&& GetStopUnderlayerText(const Stop* stop) const;
-            svg::Text&& GetStopText(svg::Color color, const Stop* stop) const;
+            svg::Text GetRouteUnderlayerText(std::string route_name, const Stop& stop) const;
+            svg::Text GetRouteText(std::string route_name, svg::Color color, const Stop& stop) const;
+            svg::Text GetStopUnderlayerText(const Stop& stop) const;
+            svg::Text GetStopText(svg::Color color, const Stop& stop) const;
 
             RenderSetup setup_;
             SphereProjector sphere_projector_;
-            std::map<std::string, std::pair<std::vector<const Stop*>, bool>> routes_;
+            std::map<std::string, std::pair<std::vector<Stop>, bool>> routes_;
+            std::vector<std::pair<Stop, double>> isochrone_;
+            double isochrone_budget_ = 0.;
         };
 
     }
@@ -0,0 +1,374 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace catalogue
+{
+    namespace routing
+    {
+        namespace
+        {
+            const double INFINITE_TIME = std::numeric_limits<double>::infinity();
+            const uint32_t NO_LABEL = std::numeric_limits<uint32_t>::max();
+
+            // meters per minute in one km/h
+            const double METERS_PER_MINUTE = 1000. / 60.;
+
+            // best arrival at a stop with a given number of buses and the ride that gave it
+            struct Label
+            {
+                StopId stop;
+                uint32_t round;
+                double time;
+                // label of the stop the last bus was boarded at
+                uint32_t boarded;
+                BusId bus;
+                int span_count;
+                double ride_time;
+                // label of the same stop from an earlier round
+                uint32_t previous;
+            };
+        }
+
+        // Search state of one thread. Labels are appended as stops improve, so the labels
+        // of a round are contiguous and are also the stops marked for the next round.
+        // Per-stop and per-direction entries are valid only where their stamp matches,
+        // so nothing is cleared between queries or rounds
+        struct RaptorRouter::SearchState
+        {
+            void Reset(size_t stop_count, size_t direction_count)
+            {
+                if(stop_stamps.size() != stop_count || ++query_stamp == 0)
+                {
+                    stop_stamps.assign(stop_count, 0);
+                    latest_labels.resize(stop_count);
+                    query_stamp = 1;
+                }
+
+                if(direction_stamps.size() != direction_count)
+                {
+                    direction_stamps.assign(direction_count, 0);
+                    direction_starts.resize(direction_count);
+                    round_stamp = 0;
+                }
+
+                labels.clear();
+                arrivals.clear();
+            }
+
+            // starts a round; the queue is cleared implicitly
+            void NextRound()
+            {
+                queued.clear();
+
+                if(++round_stamp == 0)
+                {
+                    std::fill(direction_stamps.begin(), direction_stamps.end(), 0);
+                    round_stamp = 1;
+                }
+            }
+
+            // the direction is scanned from the earliest position queued
+            void Queue(uint32_t direction, uint32_t position)
+            {
+                if(direction_stamps[direction] != round_stamp)
+                {
+                    direction_stamps[direction] = round_stamp;
+                    direction_starts[direction] = position;
+                    queued.push_back(direction);
+                }
+                else
+                {
+                    direction_starts[direction] = std::min(direction_starts[direction], position);
+                }
+            }
+
+            uint32_t LatestLabel(StopId stop) const
+            {
+                return stop_stamps[stop] == query_stamp ? latest_labels[stop] : NO_LABEL;
+            }
+
+            double BestTime(StopId stop) const
+            {
+                uint32_t label = LatestLabel(stop);
+                return label == NO_LABEL ? INFINITE_TIME : labels[label].time;
+            }
+
+            // the label a bus of round may be boarded from
+            uint32_t EarlierLabel(StopId stop, uint32_t round) const
+            {
+                uint32_t label = LatestLabel(stop);
+                return label != NO_LABEL && labels[label].round == round ? labels[label].previous : label;
+            }
+
+            // a stop improved twice in one round keeps a single label
+            void SetLabel(const Label& label)
+            {
+                uint32_t latest = LatestLabel(label.stop);
+
+                if(latest != NO_LABEL && labels[latest].round == label.round)
+                {
+                    uint32_t previous = labels[latest].previous;
+                    labels[latest] = label;
+                    labels[latest].previous = previous;
+                    return;
+                }
+
+                labels.push_back(label);
+                labels.back().previous = latest;
+                stop_stamps[label.stop] = query_stamp;
+                latest_labels[label.stop] = static_cast<uint32_t>(labels.size() - 1);
+            }
+
+            std::vector<Label> labels;
+            std::vector<uint32_t> stop_stamps;
+            std::vector<uint32_t> latest_labels;
+            std::vector<uint32_t> direction_stamps;
+            std::vector<uint32_t> direction_starts;
+            std::vector<uint32_t> queued;
+            // labels of the target from the rounds that improved it
+            std::vector<uint32_t> arrivals;
+            uint32_t query_stamp = 0;
+            uint32_t round_stamp = 0;
+        };
+
+        RaptorRouter::RaptorRouter(const TransportCatalogue& catalogue, RoutingSettings settings)
+            : catalogue_(catalogue), settings_(settings)
+        {
+            if(!catalogue_.IsFrozen())
+            {
+                throw std::logic_error("routing needs a frozen catalogue");
+            }
+
+            if(settings_.bus_velocity <= 0 || settings_.bus_wait_time < 0)
+            {
+                throw std::invalid_argument("invalid routing settings");
+            }
+
+            meters_per_minute_ = settings_.bus_velocity * METERS_PER_MINUTE;
+
+            direction_offsets_.push_back(0);
+
+            for(const auto& [bus, stops] : GetBusDirections(catalogue_))
+            {
+                for(size_t i = 0; i < stops.size(); i++)
+                {
+                    direction_stops_.push_back(stops[i]);
+                    direction_meters_.push_back(i + 1 < stops.size() ? catalogue_.GetDistance(stops[i], stops[i + 1]) : 0);
+                }
+
+                direction_offsets_.push_back(static_cast<uint32_t>(direction_stops_.size()));
+                direction_buses_.push_back(bus);
+            }
+
+            components_ = FindComponents(catalogue_);
+
+            // counting sort of the direction stops by stop
+            visit_offsets_.assign(catalogue_.GetStopCount() + 1, 0);
+
+            for(StopId stop : direction_stops_)
+            {
+                visit_offsets_[stop + 1]++;
+            }
+
+            for(size_t stop = 0; stop < catalogue_.GetStopCount(); stop++)
+            {
+                visit_offsets_[stop + 1] += visit_offsets_[stop];
+            }
+
+            visits_.resize(direction_stops_.size());
+
+            std::vector<uint32_t> next(visit_offsets_.begin(), visit_offsets_.end() - 1);
+
+            for(uint32_t direction = 0; direction < direction_buses_.size(); direction++)
+            {
+                for(uint32_t position = direction_offsets_[direction]; position < direction_offsets_[direction + 1]; position++)
+                {
+                    visits_[next[direction_stops_[position]]++] = {direction, position};
+                }
+            }
+        }
+
+        std::vector<RouteResult> RaptorRouter::BuildJourneys(StopId from, StopId to) const
+        {
+            if(from == to)
+            {
+                return {RouteResult{0., {}}};
+            }
+
+            if(components_[from] != components_[to])
+            {
+                return {};
+            }
+
+            SearchState& state = GetSearchState();
+
+            Search(state, from, to, INFINITE_TIME);
+
+            const double wait_time = settings_.bus_wait_time;
+
+            std::vector<RouteResult> result;
+
+            for(uint32_t arrival : state.arrivals)
+            {
+                RouteResult journey{state.labels[arrival].time, {}};
+
+                // legs are collected from the target back
+                for(uint32_t label = arrival; state.labels[label].round > 0; label = state.labels[label].boarded)
+                {
+                    const Label& leg = state.labels[label];
+
+                    journey.items.push_back({RouteItem::Type::BUS, 0, leg.bus, leg.span_count, leg.ride_time});
+                    journey.items.push_back({RouteItem::Type::WAIT, state.labels[leg.boarded].stop, 0, 0, wait_time});
+                }
+
+                std::reverse(journey.items.begin(), journey.items.end());
+                result.push_back(std::move(journey));
+            }
+
+            return result;
+        }
+
+        void RaptorRouter::ComputeTravelTimes(StopId from, const std::vector<StopId>& targets, std::vector<double>& times) const
+        {
+            SearchState& state = GetSearchState();
+
+            Search(state, from, std::nullopt, INFINITE_TIME);
+
+            times.resize(targets.size());
+
+            for(size_t i = 0; i < targets.size(); i++)
+            {
+                times[i] = state.BestTime(targets[i]);
+            }
+        }
+
+        std::vector<std::pair<StopId, double>> RaptorRouter::FindReachableStops(StopId from, double time_limit) const
+        {
+            SearchState& state = GetSearchState();
+
+            Search(state, from, std::nullopt, time_limit);
+
+            std::vector<std::pair<StopId, double>> result;
+
+            // every reached stop has exactly one latest label
+            for(uint32_t label = 0; label < state.labels.size(); label++)
+            {
+                const StopId stop = state.labels[label].stop;
+
+                if(state.LatestLabel(stop) == label)
+                {
+                    result.emplace_back(stop, state.labels[label].time);
+                }
+            }
+
+            std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs)
+            {
+                return lhs.second < rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+            });
+
+            return result;
+        }
+
+        void RaptorRouter::Search(SearchState& state, StopId from, std::optional<StopId> to, double time_limit) const
+        {
+            state.Reset(catalogue_.GetStopCount(), direction_buses_.size());
+            state.SetLabel({from, 0, 0., NO_LABEL, 0, 0, 0., NO_LABEL});
+
+            const double wait_time = settings_.bus_wait_time;
+            size_t round_begin = 0;
+
+            for(uint32_t round = 1; round_begin < state.labels.size(); round++)
+            {
+                state.NextRound();
+
+                const size_t round_end = state.labels.size();
+
+                for(size_t i = round_begin; i < round_end; i++)
+                {
+                    // no bus boarded here can arrive within the limit
+                    if(state.labels[i].time + wait_time > time_limit)
+                    {
+                        continue;
+                    }
+
+                    StopId stop = state.labels[i].stop;
+
+                    for(uint32_t visit = visit_offsets_[stop]; visit < visit_offsets_[stop + 1]; visit++)
+                    {
+                        state.Queue(visits_[visit].direction, visits_[visit].position);
+                    }
+                }
+
+                for(uint32_t direction : state.queued)
+                {
+                    const uint32_t end = direction_offsets_[direction + 1];
+
+                    // the bus is ridden from boarded_at, boarding_time being the departure there
+                    uint32_t boarded = NO_LABEL;
+                    uint32_t boarded_at = 0;
+                    double boarding_time = INFINITE_TIME;
+                    int meters = 0;
+
+                    for(uint32_t position = state.direction_starts[direction]; position < end; position++)
+                    {
+                        const StopId stop = direction_stops_[position];
+
+                        if(boarded != NO_LABEL)
+                        {
+                            const double ride_time = meters / meters_per_minute_;
+                            const double arrival = boarding_time + ride_time;
+
+                            // no improvement at this stop, over the best arrival at the target or within the limit
+                            if(arrival < state.BestTime(stop) && arrival <= time_limit && (!to || arrival < state.BestTime(*to)))
+                            {
+                                state.SetLabel({stop, round, arrival, boarded, direction_buses_[direction],
+                                                static_cast<int>(position - boarded_at), ride_time, NO_LABEL});
+                            }
+                        }
+
+                        // an earlier bus may be left here for this one
+                        const uint32_t label = state.EarlierLabel(stop, round);
+
+                        if(label != NO_LABEL)
+                        {
+                            const double departure = state.labels[label].time + wait_time;
+
+                            if(boarded == NO_LABEL || departure < boarding_time + meters / meters_per_minute_)
+                            {
+                                boarded = label;
+                                boarded_at = position;
+                                boarding_time = departure;
+                                meters = 0;
+                            }
+                        }
+
+                        meters += direction_meters_[position];
+                    }
+                }
+
+                round_begin = round_end;
+
+                const uint32_t target = to ? state.LatestLabel(*to) : NO_LABEL;
+
+                if(target != NO_LABEL && state.labels[target].round == round)
+                {
+                    state.arrivals.push_back(target);
+                }
+            }
+        }
+
+        RaptorRouter::SearchState& RaptorRouter::GetSearchState()
+        {
+            static thread_local SearchState state;
+            return state;
+        }
+
+        const RoutingSettings& RaptorRouter::GetSettings() const
+        {
+            return settings_;
+        }
+    }
+}
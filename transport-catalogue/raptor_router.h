@@ -0,0 +1,75 @@
+#pragma once
+
+#include <optional>
+#include <utility>
+#include <vector>
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace catalogue
+{
+    namespace routing
+    {
+        // Round-based search (RAPTOR) straight over the bus routes, with no graph. Round k
+        // rides the k-th bus of a journey along every bus direction that passes a stop
+        // improved in round k - 1, so each round tells how many buses a journey takes.
+        // Times are those of TransportRouter: bus_wait_time before every boarding and the
+        // ride along the road distances. The catalogue must be frozen and outlive the router;
+        // queries may run concurrently
+        class RaptorRouter
+        {
+        public:
+            RaptorRouter(const TransportCatalogue& catalogue, RoutingSettings settings);
+
+            // Pareto-optimal journeys by total time and number of buses, fewest buses first;
+            // each one takes more buses and less time than the one before. Empty when there
+            // is no way from one stop to the other
+            std::vector<RouteResult> BuildJourneys(StopId from, StopId to) const;
+
+            // one-to-all search; times[i] becomes the travel time in minutes to targets[i],
+            // infinity where there is no way
+            void ComputeTravelTimes(StopId from, const std::vector<StopId>& targets, std::vector<double>& times) const;
+
+            // stops reached within time_limit minutes with their travel times, from included,
+            // fastest first; the search ends as soon as no stop improves within the limit
+            std::vector<std::pair<StopId, double>> FindReachableStops(StopId from, double time_limit) const;
+
+            const RoutingSettings& GetSettings() const;
+
+        private:
+            struct SearchState;
+
+            struct StopVisit
+            {
+                uint32_t direction;
+                // index into direction_stops_
+                uint32_t position;
+            };
+
+            // buffers of the calling thread, reused by every search it runs
+            static SearchState& GetSearchState();
+
+            // runs rounds until no stop improves; arrivals after time_limit minutes, and with
+            // a target those no better than the best arrival there, are not kept
+            void Search(SearchState& state, StopId from, std::optional<StopId> to, double time_limit) const;
+
+            const TransportCatalogue& catalogue_;
+            RoutingSettings settings_;
+            double meters_per_minute_;
+
+            // stops of direction i are direction_stops_[direction_offsets_[i] .. direction_offsets_[i + 1]);
+            // direction_meters_[j] is the road distance from direction_stops_[j] to the next stop
+            std::vector<uint32_t> direction_offsets_;
+            std::vector<StopId> direction_stops_;
+            std::vector<int> direction_meters_;
+            std::vector<BusId> direction_buses_;
+
+            // every place where a direction passes stop i, by stop
+            std::vector<uint32_t> visit_offsets_;
+            std::vector<StopVisit> visits_;
+
+            // by stop, see FindComponents
+            std::vector<StopId> components_;
+        };
+    }
+}
@@ -1,6 +1,11 @@
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <thread>
 #include "request_handler.h"
 #include "json_builder.h"
+#include "route_matrix.h"
 #include "geo.h"
 
 using namespace catalogue::input;
@@ -12,6 +17,23 @@ namespace catalogue
 {
     namespace requests
     {
+        namespace
+        {
+            // a router is built once and kept, so it must not see settings that are still to come
+            routing::RoutingSettings GetLoadedRoutingSettings(const JsonReader& reader)
+            {
+                if(!reader.Get().GetRoot().AsDict().count("routing_settings"s))
+                {
+                    throw std::logic_error("routing requests need routing_settings");
+                }
+
+                return reader.GetRoutingSettings();
+            }
+
+            // set on the workers of a parallel PrintResponse, which already keep every core busy
+            thread_local bool is_response_worker = false;
+        }
+
         void RequestHandler::FillCatalogueFromJson(JsonReader reader)
         {
             Document doc = reader.Get();
@@ -31,14 +53,14 @@ namespace catalogue
             {
                 if(request.AsDict().at("type").AsString() == "Bus")
                 {
-                    std::string name = request.AsDict().at("name").AsString();
+                    std::string name(request.AsDict().at("name").AsString());
                     Array stops = request.AsDict().at("stops").AsArray();
 
                     std::vector<std::string> stop_names(stops.size());
 
                     std::transform(stops.begin(), stops.end(), stop_names.begin(), [](const auto& node)
                     {
-                        return node.AsString();
+                        return std::string(node.AsString());
                     });
 
                     bool is_circular = request.AsDict().at("is_roundtrip").AsBool();
@@ -47,7 +69,7 @@ namespace catalogue
                 }
                 else
                 {
-                    std::string name = request.AsDict().at("name").AsString();
+                    std::string name(request.AsDict().at("name").AsString());
                     Dict json_distances = request.AsDict().at("road_distances").AsDict();
 
                     std::vector<std::pair<std::string, int>> distances(json_distances.size());
@@ -60,143 +82,556 @@ namespace catalogue
                     catalogue_.AddStopsDistances(name, distances);
                 }
             }
+
+            catalogue_.Freeze();
+        }
+
+        JsonReader RequestHandler::FillCatalogueFromStream(std::istream& input)
+        {
+            JsonReader reader(input, catalogue_);
+
+            catalogue_.Freeze();
+
+            return reader;
         }
 
-        Node RequestHandler::GetBusStatJson(std::string route_name, int request_id) const
+        void RequestHandler::WriteBusStat(std::string_view route_name, int request_id, Handler& out) const
         {
-            std::vector<const Stop*> stops = catalogue_.GetRouteStops(route_name);
+            std::optional<BusStats> stats = catalogue_.GetBusStats(route_name);
 
-            if(stops.empty())
+            // keys go in sorted order, as a Dict would print them
+            if(!stats || stats->stop_count == 0)
             {
-                return Builder{}.StartDict()
-                                    .Key("request_id"s).Value(request_id)
-                                    .Key("error_message"s).Value("not found"s)
-                                .EndDict().Build();
+                Builder{out}.StartDict()
+                                .Key("error_message"sv).String("not found"sv)
+                                .Key("request_id"sv).Value(request_id)
+                            .EndDict();
+                return;
             }
 
-            long double geo_distance = 0;
-            int real_distance = 0;
+            Builder{out}.StartDict()
+                            .Key("curvature"sv).Value(stats->curvature)
+                            .Key("request_id"sv).Value(request_id)
+                            .Key("route_length"sv).Value(stats->route_length)
+                            .Key("stop_count"sv).Value(stats->stop_count)
+                            .Key("unique_stop_count"sv).Value(stats->unique_stop_count)
+                        .EndDict();
+        }
 
-            double curvature = 0.;
+        void RequestHandler::WriteBusesByStop(std::string_view stop_name, int request_id, Handler& out) const
+        {
+            const std::optional<Span<BusId>> routes = catalogue_.GetStopRoutes(stop_name);
 
-            for(auto i = 0; i < (int)stops.size() - 1; i++)
+            if(!routes.has_value())
             {
-                real_distance += catalogue_.GetDistance(stops[i], stops[i + 1]);
+                Builder{out}.StartDict()
+                                .Key("error_message"sv).String("not found"sv)
+                                .Key("request_id"sv).Value(request_id)
+                            .EndDict();
+                return;
+            }
+
+            Builder builder{out};
 
-                geo_distance += geo::ComputeDistance(stops[i]->coordinates_, stops[i + 1]->coordinates_);
+            builder.StartDict().Key("buses"sv).StartArray();
 
-                curvature = (double)real_distance / geo_distance;
+            for(BusId bus : *routes)
+            {
+                builder.String(catalogue_.GetBusName(bus));
             }
 
-            std::sort(stops.begin(), stops.end(), [](const auto l, const auto r)
+            builder.EndArray()
+                        .Key("request_id"sv).Value(request_id)
+                    .EndDict();
+        }
+
+        void RequestHandler::WriteMap(const JsonReader& reader, int request_id, Handler& out) const
+        {
+            std::stringstream ss;
+            
+            RenderMap(reader, ss);
+
+            Builder{out}.StartDict()
+                            .Key("map"sv).String(ss.str())
+                            .Key("request_id"sv).Value(request_id)
+                        .EndDict();
+        }
+
+        void RequestHandler::WriteNearbyStops(const Dict& request, int request_id, Handler& out) const
+        {
+            geo::Coordinates point{request.at("latitude").AsDouble(), request.at("longitude").AsDouble()};
+
+            int count = request.at("count").AsInt();
+
+            WriteStopsWithDistances(catalogue_.FindNearestStops(point, std::max(count, 0)), request_id, out);
+        }
+
+        void RequestHandler::WriteStopsInRadius(const Dict& request, int request_id, Handler& out) const
+        {
+            geo::Coordinates point{request.at("latitude").AsDouble(), request.at("longitude").AsDouble()};
+
+            WriteStopsWithDistances(catalogue_.FindStopsInRadius(point, request.at("radius").AsDouble()), request_id, out);
+        }
+
+        void RequestHandler::WriteStopsWithDistances(const std::vector<std::pair<StopId, double>>& stops, int request_id, Handler& out) const
+        {
+            Builder builder{out};
+
+            builder.StartDict()
+                        .Key("request_id"sv).Value(request_id)
+                        .Key("stops"sv).StartArray();
+
+            for(const auto& [stop, distance] : stops)
             {
-                return l->name_ < r->name_;
-            });
+                builder.StartDict()
+                            .Key("distance"sv).Value(distance)
+                            .Key("name"sv).String(catalogue_.GetStopName(stop))
+                        .EndDict();
+            }
 
-            auto end = std::unique(stops.begin(), stops.end());
+            builder.EndArray().EndDict();
+        }
 
-            int unique_stops = std::distance(stops.begin(), end);
+        void RequestHandler::WriteRoute(const Dict& request, const JsonReader& reader, int request_id, Handler& out) const
+        {
+            auto from = catalogue_.FindStopId(request.at("from").AsString());
+            auto to = catalogue_.FindStopId(request.at("to").AsString());
 
-            return Builder{}.StartDict()
-                                .Key("request_id"s).Value(request_id)
-                                .Key("curvature"s).Value(curvature)
-                                .Key("route_length"s).Value(real_distance)
-                                .Key("stop_count"s).Value((int)(stops.size()))
-                                .Key("unique_stop_count"s).Value(unique_stops)
-                            .EndDict().Build();
+            // the fastest route unless the fewest buses are asked for
+            auto fewest_transfers = request.find("fewest_transfers");
+            const bool fewest = fewest_transfers != request.end() && fewest_transfers->second.AsBool();
+
+            std::optional<routing::RouteResult> route;
+
+            if(from && to && use_hierarchy_ && !fewest)
+            {
+                route = GetRouter(reader).BuildRoute(*from, *to);
+            }
+            else if(from && to)
+            {
+                auto journeys = GetRaptor(reader).BuildJourneys(*from, *to);
+
+                if(!journeys.empty())
+                {
+                    route = std::move(fewest ? journeys.front() : journeys.back());
+                }
+            }
+
+            if(!route)
+            {
+                Builder{out}.StartDict()
+                                .Key("error_message"sv).String("not found"sv)
+                                .Key("request_id"sv).Value(request_id)
+                            .EndDict();
+                return;
+            }
+
+            Builder builder{out};
+
+            builder.StartDict().Key("items"sv).StartArray();
+
+            for(const routing::RouteItem& item : route->items)
+            {
+                if(item.type == routing::RouteItem::Type::WAIT)
+                {
+                    builder.StartDict()
+                                .Key("stop_name"sv).String(catalogue_.GetStopName(item.stop))
+                                .Key("time"sv).Value(item.time)
+                                .Key("type"sv).String("Wait"sv)
+                            .EndDict();
+                }
+                else
+                {
+                    builder.StartDict()
+                                .Key("bus"sv).String(catalogue_.GetBusName(item.bus))
+                                .Key("span_count"sv).Value(item.span_count)
+                                .Key("time"sv).Value(item.time)
+                                .Key("type"sv).String("Bus"sv)
+                            .EndDict();
+                }
+            }
+
+            builder.EndArray()
+                        .Key("request_id"sv).Value(request_id)
+                        .Key("total_time"sv).Value(route->total_time)
+                    .EndDict();
         }
 
-        Node RequestHandler::GetBusesByStopJson(std::string stop_name, int request_id) const
+        void RequestHandler::WriteRouteMatrix(const Dict& request, const JsonReader& reader, int request_id, Handler& out) const
         {
-            const std::optional<std::unordered_set<std::string*>> routes = catalogue_.GetStopRoutes(stop_name);
+            // a missing "to" is the same list as "from"
+            auto find_stops = [this](const Array& names, std::vector<StopId>& stops)
+            {
+                for(const Node& name : names)
+                {
+                    auto stop = catalogue_.FindStopId(name.AsString());
 
-            if(!routes.has_value())
+                    if(!stop)
+                    {
+                        return false;
+                    }
+                    stops.push_back(*stop);
+                }
+                return true;
+            };
+
+            std::vector<StopId> sources;
+            std::vector<StopId> targets;
+
+            auto to = request.find("to");
+
+            if(!find_stops(request.at("from").AsArray(), sources) || 
+               !find_stops(to != request.end() ? to->second.AsArray() : request.at("from").AsArray(), targets))
             {
-                return Builder{}.StartDict()
-                                    .Key("request_id"s)
-                                    .Value(request_id)
-                                    .Key("error_message"s)
-                                    .Value("not found"s)
-                                .EndDict().Build();
+                Builder{out}.StartDict()
+                                .Key("error_message"sv).String("not found"sv)
+                                .Key("request_id"sv).Value(request_id)
+                            .EndDict();
+                return;
             }
 
-            Array buses;
+            unsigned thread_count = matrix_thread_count_ > 0 ? matrix_thread_count_ : std::max(1u, std::thread::hardware_concurrency());
 
-            for(auto str : routes.value())
+            if(is_response_worker)
             {
-                buses.push_back(*str);
+                thread_count = 1;
             }
 
-            std::sort(buses.begin(), buses.end(), [](const auto& lhs, const auto& rhs)
+            Builder builder{out};
+
+            builder.StartDict()
+                        .Key("request_id"sv).Value(request_id)
+                        .Key("rows"sv).StartArray();
+
+            routing::ComputeRouteMatrix(GetRaptor(reader), sources, targets, thread_count, [&builder](size_t, const std::vector<double>& times)
             {
-                return lhs.AsString() < rhs.AsString();
+                builder.StartArray();
+
+                for(double time : times)
+                {
+                    if(std::isinf(time))
+                    {
+                        builder.Value(nullptr);
+                    }
+                    else
+                    {
+                        builder.Value(time);
+                    }
+                }
+
+                builder.EndArray();
             });
 
-            return Builder{}.StartDict()
-                                .Key("request_id"s)
-                                .Value(request_id)
-                                .Key("buses"s)
-                                .Value(buses)
-                            .EndDict().Build();
+            builder.EndArray().EndDict();
         }
 
-        Node RequestHandler::GetMapJson(JsonReader reader, int request_id) const
+        void RequestHandler::WriteIsochrone(const Dict& request, const JsonReader& reader, int request_id, Handler& out) const
         {
-            std::stringstream ss;
-            
-            RenderMap(reader, ss);
+            auto from = catalogue_.FindStopId(request.at("from").AsString());
+
+            if(!from)
+            {
+                Builder{out}.StartDict()
+                                .Key("error_message"sv).String("not found"sv)
+                                .Key("request_id"sv).Value(request_id)
+                            .EndDict();
+                return;
+            }
+
+            const double time_budget = std::max(request.at("time_budget").AsDouble(), 0.);
+
+            auto render = request.find("render");
+            const bool is_rendered = render != request.end() && render->second.AsBool();
+
+            const auto stops = GetRaptor(reader).FindReachableStops(*from, time_budget);
+
+            Builder builder{out};
+
+            builder.StartDict();
 
-            return Builder{}.StartDict()
-                                .Key("request_id"s)
-                                .Value(request_id)
-                                .Key("map"s)
-                                .Value(ss.str())
-                            .EndDict().Build();
+            if(is_rendered)
+            {
+                std::vector<std::pair<Stop, double>> overlay(stops.size());
+
+                std::transform(stops.begin(), stops.end(), overlay.begin(), [this](const auto& stop)
+                {
+                    return std::pair<Stop, double>(catalogue_.GetStop(stop.first), stop.second);
+                });
+
+                Renderer renderer = MakeRenderer(reader);
+                renderer.SetIsochrone(std::move(overlay), time_budget);
+
+                std::stringstream ss;
+                renderer.Render(ss);
+
+                builder.Key("map"sv).String(ss.str());
+            }
+
+            builder.Key("request_id"sv).Value(request_id)
+                   .Key("stops"sv).StartArray();
+
+            for(const auto& [stop, time] : stops)
+            {
+                builder.StartDict()
+                            .Key("name"sv).String(catalogue_.GetStopName(stop))
+                            .Key("time"sv).Value(time)
+                        .EndDict();
+            }
+
+            builder.EndArray().EndDict();
         }
 
-        void RequestHandler::PrintResponse(JsonReader reader, std::ostream& stream) const
+        void RequestHandler::SetRouteMatrixThreads(unsigned thread_count)
         {
-            Document doc = reader.Get();
+            matrix_thread_count_ = thread_count;
+        }
+
+        void RequestHandler::EnableRouteHierarchy(std::string cache_path)
+        {
+            use_hierarchy_ = true;
+            hierarchy_path_ = std::move(cache_path);
+        }
+
+        const routing::TransportRouter& RequestHandler::GetRouter(const JsonReader& reader) const
+        {
+            std::call_once(router_once_, [&]()
+            {
+                router_ = std::make_unique<routing::TransportRouter>(catalogue_, GetLoadedRoutingSettings(reader));
 
-            Array stat_requests = doc.GetRoot().AsDict().at("stat_requests").AsArray();
+                if(!use_hierarchy_)
+                {
+                    return;
+                }
 
-            Array response_array;
+                if(hierarchy_path_.empty())
+                {
+                    router_->BuildHierarchy();
+                    return;
+                }
 
-            for(const auto& request : stat_requests)
+                try
+                {
+                    router_->LoadHierarchy(hierarchy_path_);
+                }
+                catch(const std::runtime_error&)
+                {
+                    router_->BuildHierarchy();
+                    router_->SaveHierarchy(hierarchy_path_);
+                }
+            });
+
+            return *router_;
+        }
+
+        const routing::RaptorRouter& RequestHandler::GetRaptor(const JsonReader& reader) const
+        {
+            std::call_once(raptor_once_, [&]()
             {
-                if(request.AsDict().at("type").AsString() == "Stop")
+                raptor_ = std::make_unique<routing::RaptorRouter>(catalogue_, GetLoadedRoutingSettings(reader));
+            });
+
+            return *raptor_;
+        }
+
+        bool RequestHandler::WriteResponse(const Node& request, const JsonReader& reader, Handler& out) const
+        {
+            const Dict& dict = request.AsDict();
+            const String& type = dict.at("type").AsString();
+
+            if(type == "Stop")
+            {
+                WriteBusesByStop(dict.at("name").AsString(), dict.at("id").AsInt(), out);
+            }
+            else if(type == "Bus")
+            {
+                WriteBusStat(dict.at("name").AsString(), dict.at("id").AsInt(), out);
+            }
+            else if(type == "Map")
+            {
+                WriteMap(reader, dict.at("id").AsInt(), out);
+            }
+            else if(type == "Nearby")
+            {
+                WriteNearbyStops(dict, dict.at("id").AsInt(), out);
+            }
+            else if(type == "StopsInRadius")
+            {
+                WriteStopsInRadius(dict, dict.at("id").AsInt(), out);
+            }
+            else if(type == "Route")
+            {
+                WriteRoute(dict, reader, dict.at("id").AsInt(), out);
+            }
+            else if(type == "RouteMatrix")
+            {
+                WriteRouteMatrix(dict, reader, dict.at("id").AsInt(), out);
+            }
+            else if(type == "Isochrone")
+            {
+                WriteIsochrone(dict, reader, dict.at("id").AsInt(), out);
+            }
+            else
+            {
+                return false;
+            }
+            return true;
+        }
+
+        void RequestHandler::PrintResponse(const JsonReader& reader, std::ostream& stream, unsigned thread_count) const
+        {
+            const Array& stat_requests = reader.Get().GetRoot().AsDict().at("stat_requests").AsArray();
+
+            StreamSink sink(stream);
+            JsonWriter writer(sink);
+
+            if(thread_count <= 1)
+            {
+                writer.StartArray();
+
+                for(const Node& request : stat_requests)
                 {
-                    response_array.push_back(GetBusesByStopJson(request.AsDict().at("name").AsString(), request.AsDict().at("id").AsInt()));
-                    continue;
+                    WriteResponse(request, reader, writer);
                 }
-                
-                if(request.AsDict().at("type").AsString() == "Bus")
+
+                writer.EndArray();
+                writer.Flush();
+                return;
+            }
+
+            if(!catalogue_.IsFrozen())
+            {
+                throw std::logic_error("parallel requests need a frozen catalogue");
+            }
+
+            // workers claim chunks of consecutive requests and serialize each chunk
+            // as an array of its own; the arrays are then spliced in request order
+            const size_t chunk_size = 256;
+            std::vector<std::string> chunks((stat_requests.size() + chunk_size - 1) / chunk_size);
+            std::atomic<size_t> next_chunk{0};
+            std::exception_ptr error;
+            std::mutex error_mutex;
+
+            auto worker = [&]()
+            {
+                is_response_worker = true;
+
+                try
+                {
+                    for(size_t chunk = next_chunk++; chunk < chunks.size(); chunk = next_chunk++)
+                    {
+                        size_t begin = chunk * chunk_size;
+                        size_t end = std::min(begin + chunk_size, stat_requests.size());
+
+                        StringSink chunk_sink;
+                        JsonWriter chunk_writer(chunk_sink);
+
+                        chunk_writer.StartArray();
+
+                        for(size_t i = begin; i < end; i++)
+                        {
+                            WriteResponse(stat_requests[i], reader, chunk_writer);
+                        }
+
+                        chunk_writer.EndArray();
+                        chunk_writer.Flush();
+
+                        chunks[chunk] = chunk_sink.Get();
+                    }
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    error = std::current_exception();
+                    next_chunk = chunks.size();
+                }
+            };
+
+            std::vector<std::thread> workers;
+
+            for(unsigned i = 0; i < thread_count; i++)
+            {
+                workers.emplace_back(worker);
+            }
+
+            for(auto& thread : workers)
+            {
+                thread.join();
+            }
+
+            if(error)
+            {
+                std::rethrow_exception(error);
+            }
+
+            bool is_first = true;
+
+            writer.WriteRaw("["sv);
+
+            for(const std::string& chunk : chunks)
+            {
+                // "[]" for a chunk without a single known request
+                std::string_view items = std::string_view(chunk).substr(1, chunk.size() - 2);
+
+                if(items.empty())
                 {
-                    response_array.push_back(GetBusStatJson(request.AsDict().at("name").AsString(), request.AsDict().at("id").AsInt()));
+                    continue;
                 }
 
-                if(request.AsDict().at("type").AsString() == "Map")
+                if(!is_first)
                 {
-                    response_array.push_back(GetMapJson(reader, request.AsDict().at("id").AsInt()));
+                    writer.WriteRaw(", "sv);
                 }
+
+                is_first = false;
+
+                writer.WriteRaw(items);
             }
 
-            json::Document result{response_array};
+            writer.WriteRaw("]"sv);
+            writer.Flush();
+        }
 
-            JsonWriter writer;
+        void RequestHandler::ProcessStream(std::istream& input, std::ostream& stream)
+        {
+            StreamSink sink(stream);
+            JsonWriter writer(sink);
+            JsonReader reader;
+
+            writer.StartArray();
 
-            writer.Print(result, stream);
+            reader.Load(input, catalogue_, [&](const Node& request, const JsonReader& sections)
+            {
+                if(!catalogue_.IsFrozen())
+                {
+                    catalogue_.Freeze();
+                }
+
+                WriteResponse(request, sections, writer);
+            });
+
+            if(!catalogue_.IsFrozen())
+            {
+                catalogue_.Freeze();
+            }
+
+            writer.EndArray();
+            writer.Flush();
+        }
+
+        void RequestHandler::RenderMap(const JsonReader& reader, std::ostream& stream) const
+        {
+            MakeRenderer(reader).Render(stream);
         }
 
-        void RequestHandler::RenderMap(JsonReader reader, std::ostream& stream) const
+        Renderer RequestHandler::MakeRenderer(const JsonReader& reader) const
         {
-            std::vector<const Stop*> all_stops = catalogue_.GetStopsIndex();
+            std::vector<Stop> all_stops = catalogue_.GetStopsIndex();
 
             std::vector<geo::Coordinates> coords(all_stops.size());
 
             std::transform(all_stops.begin(), all_stops.end(), coords.begin(), [](const auto& stop)
             {
-                return stop->coordinates_;
+                return stop.coordinates_;
             });
 
             RenderSetup render_setup = reader.GetRenderSetup();
@@ -207,16 +642,21 @@ namespace catalogue
 
             std::vector<std::string_view> buses = catalogue_.GetBuses();
 
-            for(const auto bus : buses)
+            for(BusId bus = 0; bus < buses.size(); bus++)
             {
-                const std::vector<const Stop*> stops = catalogue_.GetRouteStops(std::string(bus));
+                Route route = catalogue_.GetRoute(bus);
+
+                std::vector<Stop> stops(route.stops_.size());
 
-                bool is_roundtrip = catalogue_.GetRouteIndex().at(std::string(bus))->is_circular_;
+                std::transform(route.stops_.begin(), route.stops_.end(), stops.begin(), [this](StopId id)
+                {
+                    return catalogue_.GetStop(id);
+                });
 
-                renderer.AddRoute(bus, stops, is_roundtrip);
+                renderer.AddRoute(buses[bus], std::move(stops), route.is_circular_);
             }
 
-            renderer.Render(stream);
+            return renderer;
         }
     }
 }
\ No newline at end of file
@@ -3,6 +3,12 @@
 #include "json_reader.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "raptor_router.h"
+#include "transport_router.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
 
 using namespace catalogue::input;
 using namespace catalogue::render;
@@ -17,16 +23,59 @@ namespace catalogue
 
             RequestHandler(TransportCatalogue& catalogue) : catalogue_(catalogue) {}
             void FillCatalogueFromJson(JsonReader reader);
-            void PrintResponse(JsonReader reader, std::ostream& stream) const;
-            void RenderMap(JsonReader reader, std::ostream& stream) const;
+            // parses input once without a DOM for base_requests; the returned reader holds the other sections
+            JsonReader FillCatalogueFromStream(std::istream& input);
+            // with thread_count > 1 requests are answered on a worker pool over a frozen catalogue;
+            // responses are written in request order either way
+            void PrintResponse(const JsonReader& reader, std::ostream& stream, unsigned thread_count = 1) const;
+            // fills the catalogue and answers stat_requests while parsing input; when the sections they read
+            // come first, each response is written as soon as it is ready, so memory does not grow with the
+            // number of requests. Otherwise they are answered once the whole input is read
+            void ProcessStream(std::istream& input, std::ostream& stream);
+            void RenderMap(const JsonReader& reader, std::ostream& stream) const;
+            // Route requests that do not ask for fewest_transfers are answered over a contraction
+            // hierarchy, built when the router is. With a cache_path the hierarchy is loaded from
+            // that file and built and saved there only if the file is missing or stale. Call
+            // before the first Route request
+            void EnableRouteHierarchy(std::string cache_path = {});
+            // workers computing the rows of one RouteMatrix request; 0, the default, is one per hardware thread.
+            // A parallel PrintResponse computes each matrix on the worker answering it instead
+            void SetRouteMatrixThreads(unsigned thread_count);
 
         private:
 
-            Node GetBusStatJson(std::string route_name, int request_id) const;
-            Node GetBusesByStopJson(std::string stop_name, int request_id) const;
-            Node GetMapJson(JsonReader reader, int request_id) const;
+            // each writer streams one response object into out
+            void WriteBusStat(std::string_view route_name, int request_id, Handler& out) const;
+            void WriteBusesByStop(std::string_view stop_name, int request_id, Handler& out) const;
+            void WriteMap(const JsonReader& reader, int request_id, Handler& out) const;
+            void WriteNearbyStops(const Dict& request, int request_id, Handler& out) const;
+            void WriteStopsInRadius(const Dict& request, int request_id, Handler& out) const;
+            void WriteStopsWithDistances(const std::vector<std::pair<StopId, double>>& stops, int request_id, Handler& out) const;
+            void WriteRoute(const Dict& request, const JsonReader& reader, int request_id, Handler& out) const;
+            // rows are written as they are computed
+            void WriteRouteMatrix(const Dict& request, const JsonReader& reader, int request_id, Handler& out) const;
+            // with "render": true the response also holds the map with the reached stops coloured
+            void WriteIsochrone(const Dict& request, const JsonReader& reader, int request_id, Handler& out) const;
+            // writes nothing and returns false for an unknown request type
+            bool WriteResponse(const Node& request, const JsonReader& reader, Handler& out) const;
+
+            // the map of every bus, ready to render
+            Renderer MakeRenderer(const JsonReader& reader) const;
+
+            // both built on the first Route request that needs them, from the routing settings
+            // of that request's reader, and throw std::logic_error if the reader has none yet;
+            // Route requests use the round-based router unless the hierarchy is enabled
+            const routing::TransportRouter& GetRouter(const JsonReader& reader) const;
+            const routing::RaptorRouter& GetRaptor(const JsonReader& reader) const;
 
             TransportCatalogue& catalogue_;
+            mutable std::once_flag router_once_;
+            mutable std::unique_ptr<routing::TransportRouter> router_;
+            mutable std::once_flag raptor_once_;
+            mutable std::unique_ptr<routing::RaptorRouter> raptor_;
+            bool use_hierarchy_ = false;
+            std::string hierarchy_path_;
+            unsigned matrix_thread_count_ = 0;
         };
     }
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "route_matrix.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace catalogue
+{
+    namespace routing
+    {
+        // rows computed ahead of the one handed out, per worker
+        const size_t ROWS_AHEAD_PER_THREAD = 4;
+
+        void ComputeRouteMatrix(const RaptorRouter& router, const std::vector<StopId>& sources, 
+                                const std::vector<StopId>& targets, unsigned thread_count, const MatrixRowHandler& on_row)
+        {
+            if(thread_count <= 1 || sources.size() <= 1)
+            {
+                std::vector<double> times;
+
+                for(size_t row = 0; row < sources.size(); row++)
+                {
+                    router.ComputeTravelTimes(sources[row], targets, times);
+                    on_row(row, times);
+                }
+                return;
+            }
+
+            // row r is computed into slot r % window once row r - window has been handed out
+            const size_t window = std::min(sources.size(), thread_count * ROWS_AHEAD_PER_THREAD);
+            std::vector<std::vector<double>> slots(window);
+            // row + 1 of the row a slot holds, 0 while it holds none
+            std::vector<size_t> slot_rows(window, 0);
+
+            std::mutex mutex;
+            std::condition_variable changed;
+            size_t next_row = 0;
+            size_t handed_out = 0;
+            bool is_stopped = false;
+            std::exception_ptr error;
+
+            auto stop = [&](std::exception_ptr exception)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if(!error)
+                {
+                    error = exception;
+                }
+
+                is_stopped = true;
+                changed.notify_all();
+            };
+
+            auto worker = [&]()
+            {
+                try
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+
+                    while(true)
+                    {
+                        changed.wait(lock, [&]()
+                        {
+                            return is_stopped || next_row == sources.size() || next_row < handed_out + window;
+                        });
+
+                        if(is_stopped || next_row == sources.size())
+                        {
+                            return;
+                        }
+
+                        const size_t row = next_row++;
+
+                        lock.unlock();
+                        router.ComputeTravelTimes(sources[row], targets, slots[row % window]);
+                        lock.lock();
+
+                        slot_rows[row % window] = row + 1;
+                        changed.notify_all();
+                    }
+                }
+                catch(...)
+                {
+                    stop(std::current_exception());
+                }
+            };
+
+            std::vector<std::thread> workers;
+
+            for(unsigned i = 0; i < thread_count; i++)
+            {
+                workers.emplace_back(worker);
+            }
+
+            try
+            {
+                for(size_t row = 0; row < sources.size(); row++)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+
+                        changed.wait(lock, [&]()
+                        {
+                            return is_stopped || slot_rows[row % window] == row + 1;
+                        });
+
+                        if(is_stopped)
+                        {
+                            break;
+                        }
+                    }
+
+                    // the slot is not written again before handed_out passes row
+                    on_row(row, slots[row % window]);
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    handed_out = row + 1;
+                    changed.notify_all();
+                }
+            }
+            catch(...)
+            {
+                stop(std::current_exception());
+            }
+
+            for(auto& thread : workers)
+            {
+                thread.join();
+            }
+
+            if(error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+}
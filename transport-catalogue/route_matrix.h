@@ -0,0 +1,23 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "raptor_router.h"
+
+namespace catalogue
+{
+    namespace routing
+    {
+        // receives row i of the matrix, times[j] being the travel time in minutes from source i
+        // to target j or infinity where there is no way; times is valid only during the call
+        using MatrixRowHandler = std::function<void(size_t row, const std::vector<double>& times)>;
+
+        // Travel times from every source to every target, one one-to-all search per source.
+        // The searches run on thread_count workers over the shared router and the rows are
+        // handed to on_row in source order as soon as they are ready. Workers stay at most a
+        // few rows per thread ahead of on_row, so memory does not grow with the number of
+        // sources. An exception from a search or from on_row stops the workers and is rethrown
+        void ComputeRouteMatrix(const RaptorRouter& router, const std::vector<StopId>& sources, 
+                                const std::vector<StopId>& targets, unsigned thread_count, const MatrixRowHandler& on_row);
+    }
+}
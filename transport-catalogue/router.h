@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "graph.h"
+
+namespace graph
+{
+    // Dijkstra's search over a built graph with a binary heap of (distance, vertex);
+    // outdated heap entries are skipped when popped instead of being updated in place
+    template<typename Weight>
+    class Router
+    {
+    public:
+        struct RouteInfo
+        {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        // buffers of one search, kept between searches of the same thread
+        struct SearchState
+        {
+            std::vector<Weight> distances;
+            std::vector<EdgeId> previous_edges;
+            std::vector<std::pair<Weight, VertexId>> heap;
+        };
+
+        explicit Router(const DirectedWeightedGraph<Weight>& graph) : graph_(graph) {}
+
+        // nullopt when to cannot be reached from from; may be called from several threads
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    private:
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        const DirectedWeightedGraph<Weight>& graph_;
+    };
+
+    template<typename Weight>
+    std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from, VertexId to) const
+    {
+        static thread_local SearchState state;
+
+        const Weight infinity = std::numeric_limits<Weight>::max();
+
+        state.distances.assign(graph_.GetVertexCount(), infinity);
+        state.previous_edges.assign(graph_.GetVertexCount(), NO_EDGE);
+        state.heap.clear();
+
+        // a min-heap on top of the std heap functions, which build max-heaps
+        auto heap_order = std::greater<std::pair<Weight, VertexId>>{};
+
+        state.distances[from] = Weight{};
+        state.heap.emplace_back(Weight{}, from);
+
+        while(!state.heap.empty())
+        {
+            std::pop_heap(state.heap.begin(), state.heap.end(), heap_order);
+            auto [distance, vertex] = state.heap.back();
+            state.heap.pop_back();
+
+            if(vertex == to)
+            {
+                break;
+            }
+
+            if(distance > state.distances[vertex])
+            {
+                continue;
+            }
+
+            for(const auto& edge : graph_.GetOutgoingEdges(vertex))
+            {
+                Weight candidate = distance + edge.weight;
+
+                if(candidate < state.distances[edge.to])
+                {
+                    state.distances[edge.to] = candidate;
+                    state.previous_edges[edge.to] = edge.id;
+                    state.heap.emplace_back(candidate, edge.to);
+                    std::push_heap(state.heap.begin(), state.heap.end(), heap_order);
+                }
+            }
+        }
+
+        if(state.distances[to] == infinity)
+        {
+            return std::nullopt;
+        }
+
+        RouteInfo result{state.distances[to], {}};
+
+        for(EdgeId edge = state.previous_edges[to]; edge != NO_EDGE; edge = state.previous_edges[graph_.GetEdge(edge).from])
+        {
+            result.edges.push_back(edge);
+        }
+
+        std::reverse(result.edges.begin(), result.edges.end());
+
+        return result;
+    }
+}
@@ -0,0 +1,233 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "snapshot.h"
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace catalogue
+{
+    namespace snapshot
+    {
+        namespace
+        {
+            const uint64_t ALIGNMENT = 8;
+
+            uint64_t Align(uint64_t offset)
+            {
+                return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            }
+
+            uint64_t Checksum(const char* data, size_t size)
+            {
+                uint64_t hash = 14695981039346656037ull;
+
+                for(size_t i = 0; i < size; i++)
+                {
+                    hash ^= static_cast<unsigned char>(data[i]);
+                    hash *= 1099511628211ull;
+                }
+                return hash;
+            }
+
+            template<typename F>
+            void ForEachSection(detail::CatalogueData& data, F f)
+            {
+                f(data.stop_name_data);
+                f(data.stop_name_offsets);
+                f(data.stops_by_name);
+                f(data.stop_lats);
+                f(data.stop_lngs);
+                f(data.bus_name_data);
+                f(data.bus_name_offsets);
+                f(data.buses_by_name);
+                f(data.route_offsets);
+                f(data.route_stops);
+                f(data.route_is_circular);
+                f(data.stop_to_routes_offsets);
+                f(data.stop_to_routes);
+                f(data.distance_offsets);
+                f(data.distance_edges);
+                f(data.bus_stats);
+                f(data.grid);
+                f(data.grid_offsets);
+                f(data.grid_stops);
+            }
+
+            size_t SectionCount()
+            {
+                detail::CatalogueData data;
+                size_t count = 0;
+
+                ForEachSection(data, [&count](const auto&)
+                {
+                    count++;
+                });
+                return count;
+            }
+
+            // read-only view of the whole file; unmapped when the last owner goes away
+            std::shared_ptr<const void> MapFile(const std::string& path, size_t& size)
+            {
+#ifdef _WIN32
+                std::ifstream input(path, std::ios::binary);
+
+                if(!input)
+                {
+                    throw std::runtime_error("cannot open snapshot " + path);
+                }
+
+                auto buffer = std::make_shared<std::vector<char>>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+                size = buffer->size();
+
+                return std::shared_ptr<const void>(buffer, buffer->data());
+#else
+                int fd = open(path.c_str(), O_RDONLY);
+
+                if(fd < 0)
+                {
+                    throw std::runtime_error("cannot open snapshot " + path);
+                }
+
+                struct stat st;
+
+                if(fstat(fd, &st) != 0 || st.st_size == 0)
+                {
+                    close(fd);
+                    throw std::runtime_error("cannot read snapshot " + path);
+                }
+
+                size = static_cast<size_t>(st.st_size);
+
+                void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                close(fd);
+
+                if(address == MAP_FAILED)
+                {
+                    throw std::runtime_error("cannot map snapshot " + path);
+                }
+
+                return std::shared_ptr<const void>(address, [size](const void* ptr)
+                {
+                    munmap(const_cast<void*>(ptr), size);
+                });
+#endif
+            }
+        }
+
+        void Save(const detail::CatalogueData& data, const std::string& path)
+        {
+            detail::CatalogueData sections = data;
+
+            std::vector<Section> table;
+            uint64_t offset = Align(sizeof(Header) + SectionCount() * sizeof(Section));
+
+            ForEachSection(sections, [&](const auto& span)
+            {
+                using T = std::decay_t<decltype(*span.begin())>;
+
+                table.push_back({offset, span.size(), sizeof(T)});
+                offset = Align(offset + span.size() * sizeof(T));
+            });
+
+            std::vector<char> buffer(offset, '\0');
+
+            std::memcpy(buffer.data() + sizeof(Header), table.data(), table.size() * sizeof(Section));
+
+            size_t i = 0;
+
+            ForEachSection(sections, [&](const auto& span)
+            {
+                if(!span.empty())
+                {
+                    std::memcpy(buffer.data() + table[i].offset, span.begin(), table[i].count * table[i].element_size);
+                }
+                i++;
+            });
+
+            Header header;
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.byte_order = BYTE_ORDER_MARK;
+            header.section_count = table.size();
+            header.file_size = buffer.size();
+            header.checksum = Checksum(buffer.data() + sizeof(Header), buffer.size() - sizeof(Header));
+
+            std::memcpy(buffer.data(), &header, sizeof(Header));
+
+            std::ofstream output(path, std::ios::binary | std::ios::trunc);
+
+            if(!output.write(buffer.data(), buffer.size()))
+            {
+                throw std::runtime_error("cannot write snapshot " + path);
+            }
+        }
+
+        detail::CatalogueData Load(const std::string& path, std::shared_ptr<const void>& mapping)
+        {
+            size_t size = 0;
+            std::shared_ptr<const void> file = MapFile(path, size);
+            const char* base = static_cast<const char*>(file.get());
+
+            if(size < sizeof(Header))
+            {
+                throw std::runtime_error("snapshot is truncated");
+            }
+
+            Header header;
+            std::memcpy(&header, base, sizeof(Header));
+
+            if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+            {
+                throw std::runtime_error("not a catalogue snapshot");
+            }
+
+            if(header.version != VERSION || header.byte_order != BYTE_ORDER_MARK || header.section_count != SectionCount())
+            {
+                throw std::runtime_error("unsupported snapshot format");
+            }
+
+            if(header.file_size != size || sizeof(Header) + header.section_count * sizeof(Section) > size)
+            {
+                throw std::runtime_error("snapshot is truncated");
+            }
+
+            if(header.checksum != Checksum(base + sizeof(Header), size - sizeof(Header)))
+            {
+                throw std::runtime_error("snapshot checksum mismatch");
+            }
+
+            const char* table = base + sizeof(Header);
+            detail::CatalogueData data;
+            size_t i = 0;
+
+            ForEachSection(data, [&](auto& span)
+            {
+                using T = std::decay_t<decltype(*span.begin())>;
+
+                Section section;
+                std::memcpy(&section, table + i++ * sizeof(Section), sizeof(Section));
+
+                if(section.element_size != sizeof(T) || section.offset % ALIGNMENT != 0
+                   || section.offset > size || section.count > (size - section.offset) / sizeof(T))
+                {
+                    throw std::runtime_error("snapshot section is out of bounds");
+                }
+
+                span = Span<T>(reinterpret_cast<const T*>(base + section.offset), section.count);
+            });
+
+            mapping = std::move(file);
+
+            return data;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "transport_catalogue.h"
+
+namespace catalogue
+{
+    namespace snapshot
+    {
+        // Layout: Header, then Header::section_count Section records, then the arrays of
+        // detail::CatalogueData in declaration order, each aligned to 8 bytes.
+        // Arrays are stored in host byte order; byte_order rejects files from another endianness.
+        inline const char MAGIC[8] = {'T', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+        inline const uint32_t VERSION = 2;
+        inline const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order;
+            uint64_t section_count;
+            uint64_t file_size;
+            // FNV-1a over everything after the header
+            uint64_t checksum;
+        };
+
+        struct Section
+        {
+            uint64_t offset;
+            uint64_t count;
+            uint64_t element_size;
+        };
+
+        void Save(const detail::CatalogueData& data, const std::string& path);
+
+        // the returned views point into the mapping, which is handed over to the caller
+        detail::CatalogueData Load(const std::string& path, std::shared_ptr<const void>& mapping);
+    }
+}
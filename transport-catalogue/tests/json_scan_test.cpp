@@ -0,0 +1,158 @@
+// g++ -std=c++17 -I.. json_scan_test.cpp ../json_scan.cpp ../json.cpp
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "json.h"
+#include "json_scan.h"
+
+using namespace json;
+
+#define CHECK(expr)                                                              \
+    if(!(expr))                                                                  \
+    {                                                                            \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #expr << " failed\n"; \
+        std::exit(1);                                                            \
+    }
+
+namespace
+{
+    std::vector<scan::Level> GetLevels()
+    {
+        std::vector<scan::Level> levels{scan::Level::SCALAR};
+
+        for(scan::Level level : {scan::Level::SSE2, scan::Level::AVX2})
+        {
+            if(static_cast<int>(level) <= static_cast<int>(scan::GetSupportedLevel()))
+            {
+                levels.push_back(level);
+            }
+        }
+
+        return levels;
+    }
+
+    // the scanners as specified in json_scan.h, one byte at a time
+    const char* FindStringEnd(const char* first, const char* last)
+    {
+        while(first != last && *first != '"' && *first != '\\' && *first != '\n' && *first != '\r')
+        {
+            ++first;
+        }
+
+        return first;
+    }
+
+    const char* SkipWhitespace(const char* first, const char* last)
+    {
+        while(first != last && (*first == ' ' || *first == '\n' || *first == '\r' || *first == '\t'))
+        {
+            ++first;
+        }
+
+        return first;
+    }
+
+    const char* FindNumberEnd(const char* first, const char* last)
+    {
+        const std::string number_chars = "0123456789-+.eE";
+
+        while(first != last && number_chars.find(*first) != std::string::npos)
+        {
+            ++first;
+        }
+
+        return first;
+    }
+
+    // runs of bytes each scanner passes over, broken by one that stops it at every
+    // position of a buffer longer than two AVX2 blocks, from every start offset
+    void TestScannersAgainstReference()
+    {
+        const std::vector<std::pair<std::string, std::string>> cases = {
+            // bytes above 0x7f are not stop bytes, whatever the signedness of char
+            {"abc xyz\t\x7f\x80\xff", "\"\\\n\r"},
+            {" \n\r\t", "a\"0\x80\f\v"},
+            {"0123456789-+.eE", " ,]}a\x80"},
+        };
+
+        for(scan::Level level : GetLevels())
+        {
+            scan::SetLevel(level);
+            CHECK(scan::GetLevel() == level);
+
+            const scan::Scanners& scanners = scan::GetScanners();
+            const scan::ScanFunction functions[] = {scanners.find_string_end, scanners.skip_whitespace, scanners.find_number_end};
+            const scan::ScanFunction references[] = {FindStringEnd, SkipWhitespace, FindNumberEnd};
+
+            for(size_t i = 0; i < cases.size(); i++)
+            {
+                const auto& [run, stops] = cases[i];
+
+                for(char stop : stops)
+                {
+                    for(size_t stop_position = 0; stop_position <= 80; stop_position++)
+                    {
+                        std::string buffer;
+
+                        for(size_t j = 0; j < 80; j++)
+                        {
+                            buffer += j == stop_position ? stop : run[j % run.size()];
+                        }
+
+                        for(size_t start = 0; start < 40; start++)
+                        {
+                            const char* first = buffer.data() + start;
+                            const char* last = buffer.data() + buffer.size();
+
+                            CHECK(functions[i](first, last) == references[i](first, last));
+                            // an empty range and one that ends before the stop byte
+                            CHECK(functions[i](first, first) == first);
+                            CHECK(functions[i](first, last - 3) == references[i](first, last - 3));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void TestParseAtEveryLevel()
+    {
+        std::string long_text(100, 'x');
+        std::string spaces(70, ' ');
+        std::string document = "{" + spaces + "\"text\": \"" + long_text + "\\n\\\"" + long_text + "\",\n\t"
+            "\"numbers\": [1, -2.5e-3, 12345678901234567890, 0.000000000000000001, 1E+10]," + spaces +
+            "\"nested\": {\"empty\": \"\", \"ok\": true}\r\n}";
+
+        std::string expected;
+
+        for(scan::Level level : GetLevels())
+        {
+            scan::SetLevel(level);
+
+            std::ostringstream output;
+            Print(Load(document), output);
+
+            if(level == scan::Level::SCALAR)
+            {
+                expected = output.str();
+                CHECK(expected.find(long_text + "\\n\\\"" + long_text) != std::string::npos);
+            }
+
+            CHECK(output.str() == expected);
+        }
+    }
+}
+
+int main()
+{
+    const scan::Level supported = scan::GetSupportedLevel();
+
+    TestScannersAgainstReference();
+    TestParseAtEveryLevel();
+
+    scan::SetLevel(supported);
+
+    std::cout << "OK" << std::endl;
+}
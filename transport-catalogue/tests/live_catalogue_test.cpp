@@ -0,0 +1,181 @@
+// g++ -std=c++17 -pthread -I.. live_catalogue_test.cpp ../live_catalogue.cpp ../transport_catalogue.cpp ../snapshot.cpp ../geo.cpp ../domain.cpp
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include "live_catalogue.h"
+
+using namespace catalogue;
+
+#define CHECK(expr)                                                              \
+    if(!(expr))                                                                  \
+    {                                                                            \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #expr << " failed\n"; \
+        std::exit(1);                                                            \
+    }
+
+namespace
+{
+    // A - B - C along a line, 1000 m apart by road; bus 1 runs A B C and back
+    TransportCatalogue MakeDraft()
+    {
+        TransportCatalogue draft;
+
+        draft.AddStop("A", {55.60, 37.60});
+        draft.AddStop("B", {55.61, 37.60});
+        draft.AddStop("C", {55.62, 37.60});
+
+        draft.AddStopsDistances("A", {{"B", 1000}});
+        draft.AddStopsDistances("B", {{"C", 1000}});
+
+        draft.AddRoute("1", {"A", "B", "C"}, false);
+
+        return draft;
+    }
+
+    size_t CountBuses(const TransportCatalogue& catalogue, std::string_view stop)
+    {
+        return catalogue.GetStopRoutes(stop)->size();
+    }
+
+    void TestFirstVersion()
+    {
+        LiveCatalogue live(MakeDraft());
+
+        auto version = live.Get();
+
+        CHECK(version->IsFrozen());
+        CHECK(version->GetBusStats("1")->route_length == 4000);
+        CHECK(CountBuses(*version, "B") == 1);
+
+        CHECK(live.Get() == version);
+    }
+
+    void TestAddRoute()
+    {
+        LiveCatalogue live(MakeDraft());
+
+        auto old_version = live.Get();
+
+        live.AddRoute("2", {"C", "A", "C"}, true);
+
+        auto version = live.Get();
+
+        CHECK(version != old_version);
+        CHECK(version->GetBusStats("2")->stop_count == 3);
+        CHECK(version->GetBusStats("2")->unique_stop_count == 2);
+        // C - A has no distance of its own, so it falls back to nothing either way
+        CHECK(version->GetBusStats("2")->route_length == 0);
+        CHECK(CountBuses(*version, "A") == 2);
+        CHECK(CountBuses(*version, "B") == 1);
+
+        // the pinned version does not see the new bus
+        CHECK(!old_version->GetBusStats("2"));
+        CHECK(CountBuses(*old_version, "A") == 1);
+        CHECK(old_version->GetBusCount() == 1);
+    }
+
+    void TestSetDistance()
+    {
+        LiveCatalogue live(MakeDraft());
+
+        auto old_version = live.Get();
+
+        live.SetDistance("B", "A", 1500);
+
+        auto version = live.Get();
+
+        StopId a = *version->FindStopId("A");
+        StopId b = *version->FindStopId("B");
+
+        CHECK(version->GetDistance(a, b) == 1000);
+        CHECK(version->GetDistance(b, a) == 1500);
+        CHECK(version->GetBusStats("1")->route_length == 4500);
+
+        live.SetDistance("A", "B", 1200);
+
+        CHECK(live.Get()->GetDistance(a, b) == 1200);
+        CHECK(live.Get()->GetDistance(b, a) == 1500);
+        CHECK(live.Get()->GetBusStats("1")->route_length == 4700);
+
+        // both updates passed the pinned version by
+        CHECK(old_version->GetDistance(b, a) == 1000);
+        CHECK(old_version->GetBusStats("1")->route_length == 4000);
+        CHECK(version->GetDistance(a, b) == 1000);
+    }
+
+    void TestCloseStop()
+    {
+        LiveCatalogue live(MakeDraft());
+
+        live.AddRoute("2", {"A", "B", "C", "A"}, true);
+
+        auto old_version = live.Get();
+
+        live.SetDistance("C", "A", 2000);
+        live.CloseStop("B");
+
+        auto version = live.Get();
+
+        // both buses become A C A, with the 2000 m of C - A both ways
+        CHECK(version->GetBusStats("1")->stop_count == 3);
+        CHECK(version->GetBusStats("1")->route_length == 4000);
+        CHECK(version->GetBusStats("2")->stop_count == 3);
+        CHECK(version->GetBusStats("2")->route_length == 4000);
+        CHECK(CountBuses(*version, "B") == 0);
+        CHECK(CountBuses(*version, "C") == 2);
+
+        // the stop itself is still known
+        CHECK(version->GetStopRoutes("B").has_value());
+
+        live.CloseStop("A");
+
+        CHECK(live.Get()->GetBusStats("1")->stop_count == 1);
+        CHECK(live.Get()->GetBusStats("2")->stop_count == 1);
+        CHECK(CountBuses(*live.Get(), "C") == 2);
+
+        CHECK(old_version->GetBusStats("1")->stop_count == 5);
+        CHECK(old_version->GetBusStats("2")->stop_count == 4);
+        CHECK(CountBuses(*old_version, "B") == 2);
+        CHECK(version->GetBusStats("1")->stop_count == 3);
+    }
+
+    void TestFailedUpdate()
+    {
+        LiveCatalogue live(MakeDraft());
+
+        auto version = live.Get();
+
+        try
+        {
+            live.Update([](TransportCatalogue& next)
+            {
+                next.AddRoute("2", std::vector<StopId>{0, 1}, true);
+                throw std::runtime_error("rejected");
+            });
+            CHECK(false);
+        }
+        catch(const std::runtime_error&)
+        {
+        }
+
+        // nothing was published and the draft does not keep the change either
+        CHECK(live.Get() == version);
+
+        live.SetDistance("A", "B", 800);
+
+        CHECK(!live.Get()->GetBusStats("2"));
+        // 800 m each way, B - A falling back to A - B
+        CHECK(live.Get()->GetBusStats("1")->route_length == 3600);
+    }
+}
+
+int main()
+{
+    TestFirstVersion();
+    TestAddRoute();
+    TestSetDistance();
+    TestCloseStop();
+    TestFailedUpdate();
+
+    std::cout << "OK" << std::endl;
+}
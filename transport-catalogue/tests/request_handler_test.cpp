@@ -0,0 +1,152 @@
+// g++ -std=c++17 -pthread -I.. request_handler_test.cpp ../request_handler.cpp ../json_reader.cpp ../json.cpp ../json_scan.cpp ../json_builder.cpp ../map_renderer.cpp ../svg.cpp ../transport_router.cpp ../raptor_router.cpp ../route_matrix.cpp ../contraction_hierarchy.cpp ../transport_catalogue.cpp ../snapshot.cpp ../geo.cpp ../domain.cpp
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "request_handler.h"
+
+using namespace catalogue;
+using namespace catalogue::input;
+using namespace catalogue::requests;
+
+#define CHECK(expr)                                                              \
+    if(!(expr))                                                                  \
+    {                                                                            \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #expr << " failed\n"; \
+        std::exit(1);                                                            \
+    }
+
+namespace
+{
+    // A - B - C along a line, 1000 m apart by road; bus 1 runs A B C and back
+    const std::string BASE = R"("base_requests": [
+        {"type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.60, "road_distances": {"B": 1000}},
+        {"type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.60, "road_distances": {"C": 1000}},
+        {"type": "Stop", "name": "C", "latitude": 55.62, "longitude": 37.60},
+        {"type": "Bus", "name": "1", "stops": ["A", "B", "C"], "is_roundtrip": false}])";
+
+    const std::string RENDER = R"("render_settings": {"width": 200, "height": 200, "padding": 30,
+        "line_width": 14, "stop_radius": 5, "bus_label_font_size": 20, "bus_label_offset": [7, 15],
+        "stop_label_font_size": 18, "stop_label_offset": [7, -3], "underlayer_color": [255, 255, 255, 0.85],
+        "underlayer_width": 3, "color_palette": ["green", [255, 160, 0], "red"]})";
+
+    const std::string ROUTING = R"("routing_settings": {"bus_wait_time": 6, "bus_velocity": 40})";
+
+    const std::string STAT = R"("stat_requests": [
+        {"id": 1, "type": "Bus", "name": "1"},
+        {"id": 2, "type": "Route", "from": "A", "to": "C"},
+        {"id": 3, "type": "Map"}])";
+
+    std::string Join(const std::string& first, const std::string& second, const std::string& third, const std::string& fourth)
+    {
+        return "{" + first + ", " + second + ", " + third + ", " + fourth + "}";
+    }
+
+    std::string Stream(const std::string& document)
+    {
+        TransportCatalogue catalogue;
+        RequestHandler handler(catalogue);
+        std::istringstream input(document);
+        std::ostringstream output;
+
+        handler.ProcessStream(input, output);
+
+        return output.str();
+    }
+
+    std::string ReadThenAnswer(const std::string& document)
+    {
+        TransportCatalogue catalogue;
+        RequestHandler handler(catalogue);
+        std::istringstream input(document);
+        std::ostringstream output;
+
+        JsonReader reader = handler.FillCatalogueFromStream(input);
+        catalogue.Freeze();
+        handler.PrintResponse(reader, output);
+
+        return output.str();
+    }
+
+    void TestStreamedResponses()
+    {
+        std::string expected = ReadThenAnswer(Join(BASE, RENDER, ROUTING, STAT));
+
+        // wait 6 minutes at A, then 2000 m at 40 km/h
+        CHECK(expected.find(R"("request_id":2, "total_time":9)") != std::string::npos);
+        CHECK(expected.find("<svg") != std::string::npos);
+        CHECK(expected.find("error_message") == std::string::npos);
+
+        CHECK(Stream(Join(BASE, RENDER, ROUTING, STAT)) == expected);
+    }
+
+    void TestSectionsAfterRequests()
+    {
+        std::string expected = ReadThenAnswer(Join(BASE, RENDER, ROUTING, STAT));
+
+        CHECK(Stream(Join(STAT, BASE, RENDER, ROUTING)) == expected);
+        CHECK(Stream(Join(BASE, STAT, RENDER, ROUTING)) == expected);
+        CHECK(Stream(Join(BASE, RENDER, STAT, ROUTING)) == expected);
+        CHECK(Stream(Join(BASE, ROUTING, STAT, RENDER)) == expected);
+    }
+
+    void TestRouteWithoutSettings()
+    {
+        TransportCatalogue catalogue;
+        RequestHandler handler(catalogue);
+        std::istringstream input("{" + BASE + ", " + RENDER + ", " + STAT + "}");
+        std::ostringstream output;
+
+        try
+        {
+            handler.ProcessStream(input, output);
+            CHECK(false);
+        }
+        catch(const std::logic_error&)
+        {
+        }
+    }
+
+    // matrices answered by the workers of a parallel PrintResponse are computed on those workers
+    void TestParallelRouteMatrix()
+    {
+        std::string stat = R"("stat_requests": [)";
+
+        for(int id = 1; id <= 600; id++)
+        {
+            stat += (id > 1 ? ", " : "") + (id % 3 == 0
+                ? R"({"id": )" + std::to_string(id) + R"(, "type": "RouteMatrix", "from": ["A", "B", "C"]})"
+                : R"({"id": )" + std::to_string(id) + R"(, "type": "Route", "from": "C", "to": "A"})");
+        }
+
+        stat += "]";
+
+        std::string document = Join(BASE, RENDER, ROUTING, stat);
+        std::string expected = ReadThenAnswer(document);
+
+        // from A: B after 6 + 1.5, C after 6 + 3 on the same bus
+        CHECK(expected.find(R"("rows":[[0, 7.5, 9], [7.5, 0, 7.5], [9, 7.5, 0]])") != std::string::npos);
+
+        TransportCatalogue catalogue;
+        RequestHandler handler(catalogue);
+        std::istringstream input(document);
+        std::ostringstream output;
+
+        JsonReader reader = handler.FillCatalogueFromStream(input);
+        catalogue.Freeze();
+        handler.PrintResponse(reader, output, 4);
+
+        CHECK(output.str() == expected);
+    }
+}
+
+int main()
+{
+    TestStreamedResponses();
+    TestSectionsAfterRequests();
+    TestRouteWithoutSettings();
+    TestParallelRouteMatrix();
+
+    std::cout << "OK" << std::endl;
+}
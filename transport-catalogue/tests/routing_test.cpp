@@ -0,0 +1,236 @@
+// g++ -std=c++17 -pthread -I.. routing_test.cpp ../transport_router.cpp ../raptor_router.cpp ../route_matrix.cpp ../contraction_hierarchy.cpp ../transport_catalogue.cpp ../snapshot.cpp ../geo.cpp ../domain.cpp
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "raptor_router.h"
+#include "route_matrix.h"
+#include "transport_router.h"
+
+using namespace catalogue;
+using namespace catalogue::routing;
+
+#define CHECK(expr)                                                              \
+    if(!(expr))                                                                  \
+    {                                                                            \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #expr << " failed\n"; \
+        std::exit(1);                                                            \
+    }
+
+namespace
+{
+    const RoutingSettings SETTINGS{6, 40.};
+
+    bool IsClose(double lhs, double rhs)
+    {
+        return std::abs(lhs - rhs) < 1e-9;
+    }
+
+    double SumItems(const RouteResult& route)
+    {
+        double total = 0;
+
+        for(const RouteItem& item : route.items)
+        {
+            total += item.time;
+        }
+
+        return total;
+    }
+
+    // stops 0..15 on a 4 x 4 grid with road distances that differ by direction; rows are
+    // two-way buses, columns are loops up one column and down the next, and two more buses
+    // cross the grid. Stop 16 has no bus and stop 17 only one that ends there
+    TransportCatalogue MakeGrid()
+    {
+        TransportCatalogue catalogue;
+
+        for(int i = 0; i < 18; i++)
+        {
+            catalogue.AddStop(std::to_string(i), {55.60 + 0.01 * (i / 4), 37.60 + 0.01 * (i % 4)});
+        }
+
+        uint32_t seed = 7;
+
+        auto next_distance = [&seed]()
+        {
+            seed = seed * 1103515245 + 12345;
+            return 400 + static_cast<int>(seed >> 16) % 1600;
+        };
+
+        for(StopId from = 0; from < 16; from++)
+        {
+            std::vector<std::pair<StopId, int>> distances;
+
+            for(StopId to = 0; to < 16; to++)
+            {
+                if(to != from)
+                {
+                    distances.emplace_back(to, next_distance());
+                }
+            }
+
+            distances.emplace_back(17, next_distance());
+            catalogue.AddStopsDistances(from, distances);
+        }
+
+        for(StopId row = 0; row < 4; row++)
+        {
+            catalogue.AddRoute("row" + std::to_string(row), {row * 4, row * 4 + 1, row * 4 + 2, row * 4 + 3}, false);
+        }
+
+        catalogue.AddRoute("loop0", {0, 4, 8, 12, 13, 9, 5, 1, 0}, true);
+        catalogue.AddRoute("loop2", {2, 6, 10, 14, 15, 11, 7, 3, 2}, true);
+        catalogue.AddRoute("diagonal", {0, 5, 10, 15}, false);
+        catalogue.AddRoute("express", {12, 9, 6, 3, 0, 12}, true);
+        catalogue.AddRoute("spur", {7, 17}, false);
+
+        catalogue.Freeze();
+
+        return catalogue;
+    }
+
+    // Dijkstra over the dense graph is the reference for the hierarchy and the round-based search
+    void TestAgainstDijkstra()
+    {
+        TransportCatalogue catalogue = MakeGrid();
+
+        TransportRouter dijkstra(catalogue, SETTINGS);
+        TransportRouter hierarchy(catalogue, SETTINGS);
+        hierarchy.BuildHierarchy();
+        RaptorRouter raptor(catalogue, SETTINGS);
+
+        CHECK(!dijkstra.HasHierarchy());
+        CHECK(hierarchy.HasHierarchy());
+
+        for(StopId from = 0; from < catalogue.GetStopCount(); from++)
+        {
+            for(StopId to = 0; to < catalogue.GetStopCount(); to++)
+            {
+                auto expected = dijkstra.BuildRoute(from, to);
+                auto contracted = hierarchy.BuildRoute(from, to);
+                auto journeys = raptor.BuildJourneys(from, to);
+
+                CHECK(expected.has_value() == (from == to || (from != 16 && to != 16)));
+                CHECK(contracted.has_value() == expected.has_value());
+
+                if(!expected || from == to)
+                {
+                    continue;
+                }
+
+                CHECK(IsClose(SumItems(*expected), expected->total_time));
+                CHECK(IsClose(contracted->total_time, expected->total_time));
+                CHECK(IsClose(SumItems(*contracted), expected->total_time));
+
+                // the last journey is the fastest
+                CHECK(!journeys.empty());
+                CHECK(IsClose(journeys.back().total_time, expected->total_time));
+                CHECK(IsClose(SumItems(journeys.back()), expected->total_time));
+            }
+        }
+    }
+
+    // A - B - C on bus 1, there and back, and B - D on bus 2; 1000 m is a minute at 60 km/h
+    // and every boarding waits 6 minutes. E has no bus
+    TransportCatalogue MakeLine()
+    {
+        TransportCatalogue catalogue;
+
+        catalogue.AddStop("A", {55.60, 37.60});
+        catalogue.AddStop("B", {55.61, 37.60});
+        catalogue.AddStop("C", {55.62, 37.60});
+        catalogue.AddStop("D", {55.61, 37.61});
+        catalogue.AddStop("E", {55.70, 37.70});
+
+        catalogue.AddStopsDistances("A", {{"B", 2000}});
+        catalogue.AddStopsDistances("B", {{"C", 3000}, {"D", 4000}});
+        catalogue.AddStopsDistances("D", {{"B", 1000}});
+
+        catalogue.AddRoute("1", {"A", "B", "C"}, false);
+        catalogue.AddRoute("2", std::vector<std::string>{"B", "D"}, false);
+
+        catalogue.Freeze();
+
+        return catalogue;
+    }
+
+    void TestReachableStops()
+    {
+        TransportCatalogue catalogue = MakeLine();
+        RaptorRouter raptor(catalogue, {6, 60.});
+
+        const StopId a = *catalogue.FindStopId("A");
+        const StopId b = *catalogue.FindStopId("B");
+        const StopId c = *catalogue.FindStopId("C");
+        const StopId d = *catalogue.FindStopId("D");
+
+        using Reached = std::vector<std::pair<StopId, double>>;
+
+        // B after 6 + 2, C after 6 + 2 + 3 on the same bus, D after 8 + 6 + 4 on another
+        CHECK(raptor.FindReachableStops(a, 100.) == (Reached{{a, 0.}, {b, 8.}, {c, 11.}, {d, 18.}}));
+        // the limit itself is within it
+        CHECK(raptor.FindReachableStops(a, 11.) == (Reached{{a, 0.}, {b, 8.}, {c, 11.}}));
+        CHECK(raptor.FindReachableStops(a, 10.) == (Reached{{a, 0.}, {b, 8.}}));
+        CHECK(raptor.FindReachableStops(a, 0.) == (Reached{{a, 0.}}));
+
+        // back from D: B after 6 + 1, then A and C 6 + 2 and 6 + 3 later
+        CHECK(raptor.FindReachableStops(d, 16.) == (Reached{{d, 0.}, {b, 7.}, {a, 15.}, {c, 16.}}));
+
+        const StopId e = *catalogue.FindStopId("E");
+        CHECK(raptor.FindReachableStops(e, 100.) == (Reached{{e, 0.}}));
+    }
+
+    void TestRouteMatrix()
+    {
+        TransportCatalogue catalogue = MakeLine();
+        RaptorRouter raptor(catalogue, {6, 60.});
+
+        const double NO_WAY = std::numeric_limits<double>::infinity();
+        std::vector<StopId> sources;
+        std::vector<StopId> targets;
+
+        for(std::string_view name : {"A", "D", "E"})
+        {
+            sources.push_back(*catalogue.FindStopId(name));
+        }
+
+        for(std::string_view name : {"A", "B", "C", "D", "E"})
+        {
+            targets.push_back(*catalogue.FindStopId(name));
+        }
+
+        // the times of TestReachableStops, and none between E and the others
+        const std::vector<std::vector<double>> expected = {
+            {0., 8., 11., 18., NO_WAY},
+            {15., 7., 16., 0., NO_WAY},
+            {NO_WAY, NO_WAY, NO_WAY, NO_WAY, 0.},
+        };
+
+        for(unsigned thread_count : {1u, 2u, 8u})
+        {
+            std::vector<std::vector<double>> rows;
+
+            ComputeRouteMatrix(raptor, sources, targets, thread_count, [&rows](size_t row, const std::vector<double>& times)
+            {
+                // rows come in source order
+                CHECK(row == rows.size());
+                rows.push_back(times);
+            });
+
+            CHECK(rows == expected);
+        }
+    }
+}
+
+int main()
+{
+    TestAgainstDijkstra();
+    TestReachableStops();
+    TestRouteMatrix();
+
+    std::cout << "OK" << std::endl;
+}
@@ -0,0 +1,170 @@
+// g++ -std=c++17 -I.. snapshot_test.cpp ../transport_catalogue.cpp ../snapshot.cpp ../geo.cpp ../domain.cpp
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "snapshot.h"
+#include "transport_catalogue.h"
+
+using namespace catalogue;
+
+#define CHECK(expr)                                                              \
+    if(!(expr))                                                                  \
+    {                                                                            \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #expr << " failed\n"; \
+        std::exit(1);                                                            \
+    }
+
+namespace
+{
+    const std::string PATH = (std::filesystem::temp_directory_path() / "snapshot_test.snap").string();
+    const std::string DAMAGED_PATH = (std::filesystem::temp_directory_path() / "snapshot_test_damaged.snap").string();
+
+    // A - B - C along a line, 1000 m apart by road, C - B 1500 m; D has no bus
+    TransportCatalogue MakeCatalogue()
+    {
+        TransportCatalogue catalogue;
+
+        catalogue.AddStop("A", {55.60, 37.60});
+        catalogue.AddStop("B", {55.61, 37.60});
+        catalogue.AddStop("C", {55.62, 37.60});
+        catalogue.AddStop("D", {55.63, 37.60});
+
+        catalogue.AddStopsDistances("A", {{"B", 1000}, {"C", 2500}});
+        catalogue.AddStopsDistances("B", {{"C", 1000}});
+        catalogue.AddStopsDistances("C", {{"B", 1500}});
+
+        catalogue.AddRoute("1", {"A", "B", "C"}, false);
+        catalogue.AddRoute("2", {"A", "C", "A"}, true);
+
+        catalogue.Freeze();
+
+        return catalogue;
+    }
+
+    std::vector<char> ReadFile(const std::string& path)
+    {
+        std::ifstream input(path, std::ios::binary);
+
+        return std::vector<char>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+    void WriteFile(const std::string& path, const std::vector<char>& bytes)
+    {
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+
+        output.write(bytes.data(), bytes.size());
+    }
+
+    bool IsRejected(const std::string& path)
+    {
+        try
+        {
+            TransportCatalogue::LoadSnapshot(path);
+        }
+        catch(const std::runtime_error&)
+        {
+            return true;
+        }
+
+        return false;
+    }
+
+    void TestRoundTrip()
+    {
+        TransportCatalogue saved = MakeCatalogue();
+
+        saved.SaveSnapshot(PATH);
+
+        TransportCatalogue loaded = TransportCatalogue::LoadSnapshot(PATH);
+
+        CHECK(loaded.IsFrozen());
+        CHECK(loaded.GetStopCount() == 4);
+        CHECK(loaded.GetBusCount() == 2);
+        CHECK(*loaded.FindStopId("C") == *saved.FindStopId("C"));
+        CHECK(!loaded.FindStopId("E"));
+
+        StopId a = *loaded.FindStopId("A");
+        StopId b = *loaded.FindStopId("B");
+        StopId c = *loaded.FindStopId("C");
+
+        CHECK(loaded.GetDistance(b, c) == 1000);
+        CHECK(loaded.GetDistance(c, b) == 1500);
+        // C - A falls back to A - C
+        CHECK(loaded.GetDistance(c, a) == 2500);
+
+        for(std::string bus : {"1", "2"})
+        {
+            BusStats expected = *saved.GetBusStats(bus);
+            BusStats actual = *loaded.GetBusStats(bus);
+
+            CHECK(actual.stop_count == expected.stop_count);
+            CHECK(actual.unique_stop_count == expected.unique_stop_count);
+            CHECK(actual.route_length == expected.route_length);
+            CHECK(actual.curvature == expected.curvature);
+        }
+
+        CHECK(loaded.GetBusStats("1")->route_length == 1000 + 1000 + 1500 + 1000);
+        CHECK(loaded.GetStopRoutes("A")->size() == 2);
+        CHECK(loaded.GetStopRoutes("D")->empty());
+        CHECK(!loaded.GetStopRoutes("E"));
+    }
+
+    void TestTruncatedFile()
+    {
+        MakeCatalogue().SaveSnapshot(PATH);
+
+        std::vector<char> bytes = ReadFile(PATH);
+
+        // cut inside the data and inside the header
+        for(size_t size : {bytes.size() - 1, bytes.size() / 2, sizeof(snapshot::Header) - 1, size_t{0}})
+        {
+            WriteFile(DAMAGED_PATH, std::vector<char>(bytes.begin(), bytes.begin() + size));
+
+            CHECK(IsRejected(DAMAGED_PATH));
+        }
+    }
+
+    void TestCorruptedChecksum()
+    {
+        MakeCatalogue().SaveSnapshot(PATH);
+
+        std::vector<char> bytes = ReadFile(PATH);
+
+        // a flipped bit in the data no longer matches the checksum in the header
+        std::vector<char> damaged = bytes;
+        damaged[bytes.size() - 1] ^= 1;
+        WriteFile(DAMAGED_PATH, damaged);
+
+        CHECK(IsRejected(DAMAGED_PATH));
+
+        // and neither does a damaged checksum
+        damaged = bytes;
+        damaged[offsetof(snapshot::Header, checksum)] ^= 1;
+        WriteFile(DAMAGED_PATH, damaged);
+
+        CHECK(IsRejected(DAMAGED_PATH));
+
+        // the untouched file still loads
+        WriteFile(DAMAGED_PATH, bytes);
+
+        CHECK(!IsRejected(DAMAGED_PATH));
+    }
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestTruncatedFile();
+    TestCorruptedChecksum();
+
+    std::filesystem::remove(PATH);
+    std::filesystem::remove(DAMAGED_PATH);
+
+    std::cout << "OK" << std::endl;
+}
@@ -0,0 +1,96 @@
+// g++ -std=c++17 -I.. transport_catalogue_test.cpp ../transport_catalogue.cpp ../snapshot.cpp ../geo.cpp ../domain.cpp
+#include <cstdlib>
+#include <iostream>
+#include "transport_catalogue.h"
+
+using namespace catalogue;
+
+#define CHECK(expr)                                                              \
+    if(!(expr))                                                                  \
+    {                                                                            \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #expr << " failed\n"; \
+        std::exit(1);                                                            \
+    }
+
+namespace
+{
+    // A - B - C - D along a line, 1000 m apart by road; B - D is 2000 m and D - A 3000 m
+    TransportCatalogue MakeCatalogue()
+    {
+        TransportCatalogue catalogue;
+
+        catalogue.AddStop("A", {55.60, 37.60});
+        catalogue.AddStop("B", {55.61, 37.60});
+        catalogue.AddStop("C", {55.62, 37.60});
+        catalogue.AddStop("D", {55.63, 37.60});
+
+        catalogue.AddStopsDistances("A", {{"B", 1000}});
+        catalogue.AddStopsDistances("B", {{"C", 1000}, {"D", 2000}});
+        catalogue.AddStopsDistances("C", {{"D", 1000}});
+        catalogue.AddStopsDistances("D", {{"A", 3000}});
+
+        return catalogue;
+    }
+
+    void TestCloseStopOnTwoWayRoute()
+    {
+        TransportCatalogue catalogue = MakeCatalogue();
+
+        catalogue.AddRoute("1", {"A", "B", "C"}, false);
+        catalogue.AddRoute("2", {"A", "B", "C", "B", "D"}, false);
+        catalogue.CloseStop("C");
+
+        // A B C B A becomes A B A, with no B -> B segment
+        BusStats stats = *catalogue.GetBusStats("1");
+        CHECK(stats.stop_count == 3);
+        CHECK(stats.unique_stop_count == 2);
+        CHECK(stats.route_length == 2000);
+
+        // the two B met when C left, so the route is A B D B A
+        stats = *catalogue.GetBusStats("2");
+        CHECK(stats.stop_count == 5);
+        CHECK(stats.unique_stop_count == 3);
+        CHECK(stats.route_length == 1000 + 2000 + 2000 + 1000);
+
+        CHECK(catalogue.GetStopRoutes("C")->empty());
+        CHECK(catalogue.GetStopRoutes("B")->size() == 2);
+    }
+
+    void TestCloseStopOnRoundTrip()
+    {
+        TransportCatalogue catalogue = MakeCatalogue();
+
+        catalogue.AddRoute("1", {"A", "B", "C", "D", "A"}, true);
+        catalogue.AddRoute("2", {"A", "B", "A"}, true);
+        catalogue.CloseStop("A");
+
+        // B C D B: still a closed loop, now starting at B
+        Span<StopId> stops = catalogue.GetRouteStops("1");
+        CHECK(stops.size() == 4);
+        CHECK(stops[0] == *catalogue.FindStopId("B"));
+        CHECK(stops[3] == *catalogue.FindStopId("B"));
+
+        BusStats stats = *catalogue.GetBusStats("1");
+        CHECK(stats.stop_count == 4);
+        CHECK(stats.unique_stop_count == 3);
+        CHECK(stats.route_length == 1000 + 1000 + 2000);
+
+        // a single stop left is not a loop
+        stats = *catalogue.GetBusStats("2");
+        CHECK(stats.stop_count == 1);
+        CHECK(stats.route_length == 0);
+
+        catalogue.Freeze();
+
+        CHECK(catalogue.GetStopRoutes("A")->empty());
+        CHECK(catalogue.GetBusStats("1")->stop_count == 4);
+    }
+}
+
+int main()
+{
+    TestCloseStopOnTwoWayRoute();
+    TestCloseStopOnRoundTrip();
+
+    std::cout << "OK" << std::endl;
+}
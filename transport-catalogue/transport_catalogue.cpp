@@ -1,176 +1,1088 @@
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
 #include "transport_catalogue.h"
+#include "snapshot.h"
+#include "geo.h"
 
 namespace catalogue
 {
-    Stop* TransportCatalogue::AddStop(const std::string& name, const geo::Coordinates& coordinates)
+    namespace detail
     {
-        Stop* stop = &stops.emplace_back(std::move(name), std::move(coordinates));
+        NameTable::NameTable(const NameTable& other) : data_(other.data_), offsets_(other.offsets_)
+        {
+            RebuildIndex();
+        }
 
-        stops_index_[std::string_view(stop->name_)] = stop;
+        NameTable& NameTable::operator=(const NameTable& other)
+        {
+            if(this != &other)
+            {
+                data_ = other.data_;
+                offsets_ = other.offsets_;
+                RebuildIndex();
+            }
+            return *this;
+        }
 
-        return stop;
-    }
+        uint32_t NameTable::Add(std::string_view name)
+        {
+            uint32_t id = static_cast<uint32_t>(size());
 
-    void TransportCatalogue::AddStopsDistances(const std::string& name, const std::vector<std::pair<std::string, int>>& distances)
-    {
-        auto stop_ptr = FindStopPtr(name);
+            // index keys point into data_, so they must be refreshed after it reallocates
+            bool reallocated = data_.size() + name.size() > data_.capacity();
+
+            data_.insert(data_.end(), name.begin(), name.end());
+            offsets_.push_back(static_cast<uint32_t>(data_.size()));
+
+            if(reallocated)
+            {
+                RebuildIndex();
+            }
+            else
+            {
+                index_[(*this)[id]] = id;
+            }
 
-        if(stop_ptr)
+            return id;
+        }
+
+        std::optional<uint32_t> NameTable::Find(std::string_view name) const
         {
-            for(const auto& [name, distance] : distances)
+            auto it = index_.find(name);
+
+            if(it != index_.end())
             {
-                auto next_stop_ptr = FindStopPtr(name);
+                return it->second;
+            }
+            return std::nullopt;
+        }
 
-                if(next_stop_ptr)
-                {
-                    stop_distances_[{stop_ptr, next_stop_ptr}] = distance;
-                }
+        std::string_view NameTable::operator[](uint32_t id) const
+        {
+            return std::string_view(data_.data() + offsets_[id], offsets_[id + 1] - offsets_[id]);
+        }
+
+        size_t NameTable::size() const
+        {
+            return offsets_.size() - 1;
+        }
+
+        Span<char> NameTable::GetData() const
+        {
+            return Span<char>(data_.data(), data_.size());
+        }
+
+        Span<uint32_t> NameTable::GetOffsets() const
+        {
+            return Span<uint32_t>(offsets_.data(), offsets_.size());
+        }
+
+        void NameTable::ShrinkToFit()
+        {
+            data_.shrink_to_fit();
+            offsets_.shrink_to_fit();
+            RebuildIndex();
+        }
+
+        void NameTable::RebuildIndex()
+        {
+            index_.clear();
+            index_.reserve(size());
+
+            // a later duplicate name overrides an earlier one, as with direct insertion
+            for(uint32_t id = 0; id < size(); id++)
+            {
+                index_[(*this)[id]] = id;
             }
         }
+
+        template<typename T>
+        Span<T> MakeSpan(const std::vector<T>& values)
+        {
+            return Span<T>(values.data(), values.size());
+        }
+
+        std::string_view GetName(Span<char> data, Span<uint32_t> offsets, uint32_t id)
+        {
+            return std::string_view(data.begin() + offsets[id], offsets[id + 1] - offsets[id]);
+        }
+
+        // ids are sorted by name, equal names by id; the last of equal names wins as in NameTable
+        std::optional<uint32_t> FindSorted(Span<uint32_t> by_name, Span<char> data, Span<uint32_t> offsets, std::string_view name)
+        {
+            auto it = std::upper_bound(by_name.begin(), by_name.end(), name, [&](std::string_view lhs, uint32_t rhs)
+            {
+                return lhs < GetName(data, offsets, rhs);
+            });
+
+            if(it != by_name.begin() && GetName(data, offsets, *(it - 1)) == name)
+            {
+                return *(it - 1);
+            }
+            return std::nullopt;
+        }
+
+        const double RADIANS_PER_DEGREE = 3.14159265358979323846 / 180.;
+        const double METERS_PER_DEGREE = geo::EARTH_RADIUS * RADIANS_PER_DEGREE;
+
+        // cell index along one axis, clamped into the grid
+        uint32_t GetCellIndex(double value, double min, double cell, uint32_t cells)
+        {
+            double index = std::floor((value - min) / cell);
+
+            return static_cast<uint32_t>(std::clamp(index, 0., static_cast<double>(cells - 1)));
+        }
+
+        uint32_t GetCell(const GridHeader& grid, geo::Coordinates point)
+        {
+            return GetCellIndex(point.lat, grid.min_lat, grid.cell_lat, grid.rows) * grid.cols
+                 + GetCellIndex(point.lng, grid.min_lng, grid.cell_lng, grid.cols);
+        }
+
+        std::vector<uint32_t> SortByName(const NameTable& names)
+        {
+            std::vector<uint32_t> result(names.size());
+
+            for(uint32_t id = 0; id < result.size(); id++)
+            {
+                result[id] = id;
+            }
+
+            std::stable_sort(result.begin(), result.end(), [&names](uint32_t lhs, uint32_t rhs)
+            {
+                return names[lhs] < names[rhs];
+            });
+
+            return result;
+        }
+
+        // whether the catalogue holding the part may change it in place
+        template<typename T>
+        bool IsOnlyOwner(const std::shared_ptr<T>& part)
+        {
+            if(part.use_count() != 1)
+            {
+                return false;
+            }
+
+            // pairs with the release of the last other owner, which may have been a reader
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+
+        // the part itself when the catalogue is its only owner, otherwise a copy put in its place
+        template<typename T>
+        T& Modify(std::shared_ptr<T>& part)
+        {
+            if(!IsOnlyOwner(part))
+            {
+                part = std::make_shared<T>(*part);
+            }
+            return *part;
+        }
     }
 
-    std::string* TransportCatalogue::AddBus(const std::string&& name)
+    StopId TransportCatalogue::AddStop(std::string_view name, const geo::Coordinates& coordinates)
     {
-        return &buses_.emplace_back(std::move(name));
+        CheckNotFrozen();
+
+        detail::StopTable& stops = detail::Modify(stops_);
+
+        StopId id = stops.names.Add(name);
+
+        stops.lats.push_back(coordinates.lat);
+        stops.lngs.push_back(coordinates.lng);
+
+        // every index is sized by the number of stops; the stats of existing buses stay
+        dirty_ = ALL_INDEXES;
+
+        return id;
     }
 
-    void TransportCatalogue::AddRoute(std::string&& route_name, std::vector<std::string>&& stop_names, bool is_circular)
+    void TransportCatalogue::AddStopsDistances(std::string_view name, const std::vector<std::pair<std::string, int>>& distances)
     {
-        auto bus_ptr = AddBus(std::move(route_name));
+        CheckNotFrozen();
+
+        auto stop_id = FindStopId(name);
+
+        if(!stop_id)
+        {
+            return;
+        }
 
-        auto route = MakeRoute(std::move(stop_names), is_circular);
+        std::vector<std::pair<StopId, int>> resolved;
 
-        routes_index[std::string_view(*bus_ptr)] = route;
+        resolved.reserve(distances.size());
 
-        for(auto stop_ptr : route->stops_)
+        for(const auto& [name, distance] : distances)
         {
-            UpdateStopIndex(stop_ptr, bus_ptr);
+            auto next_stop_id = FindStopId(name);
+
+            if(next_stop_id)
+            {
+                resolved.emplace_back(*next_stop_id, distance);
+            }
         }
+
+        AddStopsDistances(*stop_id, resolved);
     }
 
-    Route* TransportCatalogue::MakeRoute(const std::vector<std::string>&& stop_names, bool is_circular)
+    void TransportCatalogue::AddRoute(std::string&& route_name, std::vector<std::string>&& stop_names, bool is_circular)
     {
-        std::vector<const Stop*> stop_ptrs;
+        CheckNotFrozen();
+
+        std::vector<StopId> stops;
+
+        stops.reserve(stop_names.size());
 
         for(const auto& stop : stop_names)
         {
-            auto stop_ptr = FindStopPtr(stop);
+            auto stop_id = FindStopId(stop);
 
-            if(stop_ptr)
+            if(stop_id)
             {
-                stop_ptrs.push_back(stop_ptr);
+                stops.push_back(*stop_id);
             }
         }
 
+        AddRoute(route_name, stops, is_circular);
+    }
+
+    void TransportCatalogue::AddStopsDistances(StopId stop, const std::vector<std::pair<StopId, int>>& distances)
+    {
+        CheckNotFrozen();
+
+        if(distances.empty())
+        {
+            return;
+        }
+
+        detail::DistanceMap& map = detail::Modify(distances_);
+
+        for(const auto& [next_stop, distance] : distances)
+        {
+            map[{stop, next_stop}] = distance;
+        }
+
+        // every changed distance is on a segment from this stop or to it
+        changed_stops_.push_back(stop);
+        dirty_ |= DISTANCE_TABLE | BUS_STATS;
+    }
+
+    void TransportCatalogue::AddRoute(std::string_view route_name, const std::vector<StopId>& stops, bool is_circular)
+    {
+        CheckNotFrozen();
+
+        detail::RouteTable& routes = detail::Modify(routes_);
+
+        size_t begin = routes.stops.size();
+
+        routes.stops.insert(routes.stops.end(), stops.begin(), stops.end());
+
         if(!is_circular)
         {
-            for(int i = stop_ptrs.size() - 2; i > -1; i--)
+            for(int i = routes.stops.size() - 2; i >= (int)begin; i--)
             {
-                stop_ptrs.push_back(stop_ptrs[i]);
+                routes.stops.push_back(routes.stops[i]);
             }
         }
 
-        auto route = &routes_.emplace_back(stop_ptrs, is_circular);
+        routes.offsets.push_back(static_cast<uint32_t>(routes.stops.size()));
+        routes.is_circular.push_back(is_circular);
+
+        routes.names.Add(route_name);
 
-        return route;
+        dirty_ |= ROUTE_INDEX | BUS_STATS;
     }
 
-    void TransportCatalogue::UpdateStopIndex(const Stop* stop_ptr, std::string* route_name_ptr)
+    void TransportCatalogue::CloseStop(std::string_view name)
     {
-        if(stop_ptr == nullptr || route_name_ptr == nullptr)
+        CheckNotFrozen();
+
+        auto stop_id = FindStopId(name);
+
+        const detail::RouteTable& routes = *routes_;
+
+        if(!stop_id || std::find(routes.stops.begin(), routes.stops.end(), *stop_id) == routes.stops.end())
         {
             return;
         }
-        
-        stop_to_routes_index_[stop_ptr].insert(route_name_ptr);
+
+        std::vector<StopId> result;
+        result.reserve(routes.stops.size());
+
+        std::vector<uint32_t> offsets{0};
+        offsets.reserve(routes.offsets.size());
+
+        std::vector<StopId> stops;
+
+        for(BusId bus = 0; bus + 1 < routes.offsets.size(); bus++)
+        {
+            Span<StopId> route(routes.stops.data() + routes.offsets[bus], routes.offsets[bus + 1] - routes.offsets[bus]);
+            const bool is_circular = routes.is_circular[bus] != 0;
+            const bool is_closed = is_circular && route.size() > 1 && route[0] == route[route.size() - 1];
+
+            // the stops as given to AddRoute: a two-way route without its way back,
+            // a closed round trip without the repeated first stop
+            size_t size = is_circular ? route.size() - is_closed : (route.size() + 1) / 2;
+
+            // neighbours of the removed stop may meet and are then merged into one stop
+            stops.clear();
+
+            bool is_changed = false;
+
+            for(size_t i = 0; i < size; i++)
+            {
+                if(route[i] == *stop_id)
+                {
+                    is_changed = true;
+                }
+                else if(stops.empty() || stops.back() != route[i])
+                {
+                    stops.push_back(route[i]);
+                }
+            }
+
+            if(is_closed)
+            {
+                while(stops.size() > 1 && stops.back() == stops.front())
+                {
+                    stops.pop_back();
+                }
+
+                // a single stop left is not a loop
+                if(stops.size() > 1)
+                {
+                    stops.push_back(stops.front());
+                }
+            }
+
+            if(is_changed)
+            {
+                changed_buses_.push_back(bus);
+            }
+
+            result.insert(result.end(), stops.begin(), stops.end());
+
+            if(!is_circular)
+            {
+                result.insert(result.end(), stops.rbegin() + std::min<size_t>(stops.size(), 1), stops.rend());
+            }
+
+            offsets.push_back(static_cast<uint32_t>(result.size()));
+        }
+
+        detail::RouteTable& changed = detail::Modify(routes_);
+
+        changed.stops = std::move(result);
+        changed.offsets = std::move(offsets);
+
+        dirty_ |= ROUTE_INDEX | BUS_STATS;
+    }
+
+    void TransportCatalogue::BuildIndexes() const
+    {
+        Data();
     }
 
-    const std::vector<const Stop*> TransportCatalogue::GetRouteStops(const std::string& route_name) const
+    void TransportCatalogue::Freeze()
     {
-        auto it = routes_index.find(route_name);
+        if(frozen_)
+        {
+            return;
+        }
 
-        if(it != routes_index.end())
+        Data();
+
+        distances_.reset();
+
+        // parts shared with other catalogues are left as they are
+        if(detail::IsOnlyOwner(stops_))
         {
-            return it->second->stops_;
+            stops_->names.ShrinkToFit();
+            stops_->lats.shrink_to_fit();
+            stops_->lngs.shrink_to_fit();
         }
-        return std::vector<const Stop*>();
+
+        if(detail::IsOnlyOwner(routes_))
+        {
+            routes_->names.ShrinkToFit();
+            routes_->offsets.shrink_to_fit();
+            routes_->stops.shrink_to_fit();
+            routes_->is_circular.shrink_to_fit();
+        }
+
+        UpdateViews();
+
+        frozen_ = true;
     }
 
-    const Stop* TransportCatalogue::FindStopPtr(const std::string& stop_name) const
+    bool TransportCatalogue::IsFrozen() const
     {
-        auto it = stops_index_.find(stop_name);
+        return frozen_;
+    }
+
+    void TransportCatalogue::SaveSnapshot(const std::string& path) const
+    {
+        snapshot::Save(Data(), path);
+    }
 
-        if(it != stops_index_.end())
+    TransportCatalogue TransportCatalogue::LoadSnapshot(const std::string& path)
+    {
+        TransportCatalogue result;
+
+        result.data_ = snapshot::Load(path, result.mapping_);
+        result.dirty_ = 0;
+        result.frozen_ = true;
+
+        return result;
+    }
+
+    void TransportCatalogue::CheckNotFrozen() const
+    {
+        if(frozen_)
         {
-            return it->second;
+            throw std::logic_error("catalogue is frozen");
         }
-        return nullptr;
     }
 
-    const std::optional<std::unordered_set<std::string*>> TransportCatalogue::GetStopRoutes(const std::string& stop_name) const
+    const detail::CatalogueData& TransportCatalogue::Data() const
     {
-        auto stop_ptr = FindStopPtr(stop_name);
+        if(dirty_)
+        {
+            Rebuild();
+        }
+        return data_;
+    }
 
-        if(!stop_ptr)
+    void TransportCatalogue::Rebuild() const
+    {
+        if(dirty_ & STOP_INDEX)
         {
-            return std::nullopt;
+            BuildStopIndex();
+        }
+
+        if(dirty_ & ROUTE_INDEX)
+        {
+            BuildRouteIndex();
+        }
+
+        if(dirty_ & DISTANCE_TABLE)
+        {
+            BuildDistanceTable();
         }
 
-        auto found_it = stop_to_routes_index_.find(stop_ptr);
+        UpdateViews();
 
-        if(found_it != stop_to_routes_index_.end())
+        // bus stats are computed through the regular query path over the fresh indexes
+        const bool is_stats_stale = dirty_ & BUS_STATS;
+
+        dirty_ = 0;
+
+        if(is_stats_stale)
         {
-            return std::optional<std::unordered_set<std::string*>>{found_it->second};
+            BuildBusStats();
+            UpdateViews();
         }
-        return std::optional<std::unordered_set<std::string*>>{std::unordered_set<std::string*>()};
     }
 
-    int TransportCatalogue::GetDistance(const Stop* stop1, const Stop* stop2) const
+    void TransportCatalogue::UpdateViews() const
     {
-        auto it = stop_distances_.find({stop1, stop2});
+        if(mapping_)
+        {
+            return;
+        }
+
+        data_.stop_name_data = stops_->names.GetData();
+        data_.stop_name_offsets = stops_->names.GetOffsets();
+        data_.stops_by_name = detail::MakeSpan(stop_index_->by_name);
+        data_.stop_lats = detail::MakeSpan(stops_->lats);
+        data_.stop_lngs = detail::MakeSpan(stops_->lngs);
+
+        data_.bus_name_data = routes_->names.GetData();
+        data_.bus_name_offsets = routes_->names.GetOffsets();
+        data_.buses_by_name = detail::MakeSpan(route_index_->by_name);
 
-        if(it != stop_distances_.end())
+        data_.route_offsets = detail::MakeSpan(routes_->offsets);
+        data_.route_stops = detail::MakeSpan(routes_->stops);
+        data_.route_is_circular = detail::MakeSpan(routes_->is_circular);
+
+        data_.stop_to_routes_offsets = detail::MakeSpan(route_index_->stop_to_routes_offsets);
+        data_.stop_to_routes = detail::MakeSpan(route_index_->stop_to_routes);
+
+        data_.distance_offsets = detail::MakeSpan(distance_table_->offsets);
+        data_.distance_edges = detail::MakeSpan(distance_table_->edges);
+
+        data_.bus_stats = detail::MakeSpan(*bus_stats_);
+
+        data_.grid = Span<detail::GridHeader>(&stop_index_->grid, 1);
+        data_.grid_offsets = detail::MakeSpan(stop_index_->grid_offsets);
+        data_.grid_stops = detail::MakeSpan(stop_index_->grid_stops);
+    }
+
+    void TransportCatalogue::BuildStopIndex() const
+    {
+        const detail::StopTable& stops = *stops_;
+        auto index = std::make_shared<detail::StopIndex>();
+
+        index->by_name = detail::SortByName(stops.names);
+
+        detail::GridHeader& grid = index->grid;
+
+        if(!stops.lats.empty())
+        {
+            auto [min_lat, max_lat] = std::minmax_element(stops.lats.begin(), stops.lats.end());
+            auto [min_lng, max_lng] = std::minmax_element(stops.lngs.begin(), stops.lngs.end());
+
+            double span_lat = *max_lat - *min_lat;
+            double span_lng = *max_lng - *min_lng;
+
+            double height = span_lat * detail::METERS_PER_DEGREE;
+            double width = span_lng * detail::METERS_PER_DEGREE * std::cos((*min_lat + *max_lat) / 2 * detail::RADIANS_PER_DEGREE);
+
+            // about two stops per cell on a uniform spread
+            double cell_size = std::sqrt(std::max(height * width, 1.) / std::max<size_t>(stops.lats.size() / 2, 1));
+
+            grid.min_lat = *min_lat;
+            grid.min_lng = *min_lng;
+            grid.rows = static_cast<uint32_t>(std::clamp(std::ceil(height / cell_size), 1., 4096.));
+            grid.cols = static_cast<uint32_t>(std::clamp(std::ceil(width / cell_size), 1., 4096.));
+            grid.cell_lat = span_lat > 0 ? span_lat / grid.rows : 1.;
+            grid.cell_lng = span_lng > 0 ? span_lng / grid.cols : 1.;
+        }
+
+        std::vector<uint32_t> cells(stops.lats.size());
+
+        index->grid_offsets.assign(grid.rows * grid.cols + 1, 0);
+
+        for(StopId stop = 0; stop < cells.size(); stop++)
+        {
+            cells[stop] = detail::GetCell(grid, {stops.lats[stop], stops.lngs[stop]});
+            index->grid_offsets[cells[stop] + 1]++;
+        }
+
+        for(size_t i = 1; i < index->grid_offsets.size(); i++)
         {
-            return it->second;
+            index->grid_offsets[i] += index->grid_offsets[i - 1];
         }
 
-        auto it1 = stop_distances_.find({stop2, stop1});
+        index->grid_stops.resize(cells.size());
+
+        std::vector<uint32_t> next(index->grid_offsets.begin(), index->grid_offsets.end() - 1);
 
-        if(it1 != stop_distances_.end())
+        for(StopId stop = 0; stop < cells.size(); stop++)
         {
-            return it1->second;
+            index->grid_stops[next[cells[stop]]++] = stop;
         }
-        return 0;
+
+        stop_index_ = std::move(index);
     }
 
-    std::vector<std::string_view> TransportCatalogue::GetBuses() const
+    void TransportCatalogue::BuildRouteIndex() const
     {
-        std::vector<std::string_view> result(buses_.size());
+        const detail::RouteTable& routes = *routes_;
+        const size_t stop_count = stops_->names.size();
+        auto index = std::make_shared<detail::RouteIndex>();
+
+        index->by_name = detail::SortByName(routes.names);
+
+        // last bus that touched a stop, to count a stop repeated within one route only once
+        std::vector<BusId> last_bus(stop_count, static_cast<BusId>(-1));
 
-        std::transform(buses_.begin(), buses_.end(), result.begin(), [](const auto& str)
+        std::vector<uint32_t>& offsets = index->stop_to_routes_offsets;
+
+        offsets.assign(stop_count + 1, 0);
+
+        for(BusId bus : index->by_name)
+        {
+            for(uint32_t i = routes.offsets[bus]; i < routes.offsets[bus + 1]; i++)
+            {
+                StopId stop = routes.stops[i];
+
+                if(last_bus[stop] != bus)
+                {
+                    last_bus[stop] = bus;
+                    offsets[stop + 1]++;
+                }
+            }
+        }
+
+        for(size_t i = 1; i < offsets.size(); i++)
+        {
+            offsets[i] += offsets[i - 1];
+        }
+
+        index->stop_to_routes.resize(offsets.back());
+
+        std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+        std::fill(last_bus.begin(), last_bus.end(), static_cast<BusId>(-1));
+
+        // buses are visited in name order, so every stop's slice comes out sorted
+        for(BusId bus : index->by_name)
+        {
+            for(uint32_t i = routes.offsets[bus]; i < routes.offsets[bus + 1]; i++)
+            {
+                StopId stop = routes.stops[i];
+
+                if(last_bus[stop] != bus)
+                {
+                    last_bus[stop] = bus;
+                    index->stop_to_routes[next[stop]++] = bus;
+                }
+            }
+        }
+
+        route_index_ = std::move(index);
+    }
+
+    void TransportCatalogue::BuildDistanceTable() const
+    {
+        struct Record
+        {
+            StopId from;
+            StopId to;
+            int distance;
+            bool is_reverse;
+        };
+
+        std::vector<Record> records;
+        records.reserve(distances_->size() * 2);
+
+        for(const auto& [stops, distance] : *distances_)
         {
-            return std::string_view(str);
+            records.push_back({stops.first, stops.second, distance, false});
+            records.push_back({stops.second, stops.first, distance, true});
+        }
+
+        // an explicitly given distance sorts ahead of the fallback from the opposite direction
+        std::sort(records.begin(), records.end(), [](const Record& lhs, const Record& rhs)
+        {
+            return std::tie(lhs.from, lhs.to, lhs.is_reverse) < std::tie(rhs.from, rhs.to, rhs.is_reverse);
         });
+
+        auto end = std::unique(records.begin(), records.end(), [](const Record& lhs, const Record& rhs)
+        {
+            return lhs.from == rhs.from && lhs.to == rhs.to;
+        });
+
+        records.erase(end, records.end());
+
+        // merged row by row with the previous table, in which a given distance again wins over a fallback
+        const detail::DistanceTable& previous = *distance_table_;
+        const size_t stop_count = stops_->names.size();
+
+        auto table = std::make_shared<detail::DistanceTable>();
+
+        table->offsets.assign(stop_count + 1, 0);
+        table->edges.reserve(previous.edges.size() + records.size());
+        table->is_explicit.reserve(previous.edges.size() + records.size());
+
+        auto add = [&table](StopId to, int distance, bool is_explicit)
+        {
+            table->edges.push_back({to, distance});
+            table->is_explicit.push_back(is_explicit);
+        };
+
+        size_t next = 0;
+
+        for(StopId from = 0; from < stop_count; from++)
+        {
+            // stops added since the previous build have no row there
+            uint32_t i = from + 1 < previous.offsets.size() ? previous.offsets[from] : 0;
+            const uint32_t row_end = from + 1 < previous.offsets.size() ? previous.offsets[from + 1] : 0;
+
+            while(i < row_end || (next < records.size() && records[next].from == from))
+            {
+                if(next == records.size() || records[next].from != from || (i < row_end && previous.edges[i].to < records[next].to))
+                {
+                    add(previous.edges[i].to, previous.edges[i].distance, previous.is_explicit[i] != 0);
+                    i++;
+                    continue;
+                }
+
+                const Record& record = records[next++];
+
+                if(i < row_end && previous.edges[i].to == record.to)
+                {
+                    if(record.is_reverse && previous.is_explicit[i])
+                    {
+                        add(previous.edges[i].to, previous.edges[i].distance, true);
+                        i++;
+                        continue;
+                    }
+                    i++;
+                }
+
+                add(record.to, record.distance, !record.is_reverse);
+            }
+
+            table->offsets[from + 1] = static_cast<uint32_t>(table->edges.size());
+        }
+
+        distances_ = std::make_shared<detail::DistanceMap>();
+        distance_table_ = std::move(table);
+    }
+
+    void TransportCatalogue::BuildBusStats() const
+    {
+        const size_t bus_count = routes_->names.size();
+        const size_t kept_count = std::min(bus_stats_->size(), bus_count);
+
+        // stats of the buses added since the last build are computed, and so are those of
+        // the buses that were changed or pass a stop whose distances were
+        std::vector<char> is_stale(bus_count, 0);
+
+        std::fill(is_stale.begin() + kept_count, is_stale.end(), 1);
+
+        for(BusId bus : changed_buses_)
+        {
+            is_stale[bus] = 1;
+        }
+
+        for(StopId stop : changed_stops_)
+        {
+            for(uint32_t i = data_.stop_to_routes_offsets[stop]; i < data_.stop_to_routes_offsets[stop + 1]; i++)
+            {
+                is_stale[data_.stop_to_routes[i]] = 1;
+            }
+        }
+
+        changed_buses_.clear();
+        changed_stops_.clear();
+
+        auto all_stats = std::make_shared<std::vector<BusStats>>(bus_stats_->begin(), bus_stats_->begin() + kept_count);
+        all_stats->resize(bus_count);
+
+        // stamp of the last bus that visited a stop, for counting unique stops without sorting
+        std::vector<BusId> last_bus(stops_->names.size(), static_cast<BusId>(-1));
+
+        for(BusId bus = 0; bus < bus_count; bus++)
+        {
+            if(!is_stale[bus])
+            {
+                continue;
+            }
+
+            Span<StopId> stops = GetRoute(bus).stops_;
+            BusStats& stats = (*all_stats)[bus];
+
+            stats = BusStats{};
+
+            long double geo_distance = 0;
+
+            for(size_t i = 0; i + 1 < stops.size(); i++)
+            {
+                stats.route_length += GetDistance(stops[i], stops[i + 1]);
+
+                geo_distance += geo::ComputeDistance(GetStopCoordinates(stops[i]), GetStopCoordinates(stops[i + 1]));
+            }
+
+            if(stops.size() > 1)
+            {
+                stats.curvature = (double)stats.route_length / geo_distance;
+            }
+
+            for(StopId stop : stops)
+            {
+                if(last_bus[stop] != bus)
+                {
+                    last_bus[stop] = bus;
+                    stats.unique_stop_count++;
+                }
+            }
+
+            stats.geo_length = geo_distance;
+            stats.stop_count = stops.size();
+        }
+
+        bus_stats_ = std::move(all_stats);
+    }
+
+    std::vector<std::pair<StopId, double>> TransportCatalogue::FindNearestStops(geo::Coordinates point, size_t count) const
+    {
+        const detail::CatalogueData& data = Data();
+        const detail::GridHeader& grid = data.grid[0];
+
+        auto closer = [](const std::pair<StopId, double>& lhs, const std::pair<StopId, double>& rhs)
+        {
+            return lhs.second < rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+        };
+
+        // max-heap of the best candidates so far
+        std::vector<std::pair<StopId, double>> result;
+
+        if(count == 0 || data.grid_stops.empty())
+        {
+            return result;
+        }
+
+        int row = static_cast<int>(detail::GetCellIndex(point.lat, grid.min_lat, grid.cell_lat, grid.rows));
+        int col = static_cast<int>(detail::GetCellIndex(point.lng, grid.min_lng, grid.cell_lng, grid.cols));
+
+        // cells are scanned in square rings around the point's cell until the ring can no
+        // longer hold anything closer than the current k-th candidate
+        const double min_cos = std::cos(std::min(std::max({std::abs(point.lat), std::abs(grid.min_lat), std::abs(grid.min_lat + grid.cell_lat * grid.rows)}), 89.) * detail::RADIANS_PER_DEGREE);
+        const int max_ring = static_cast<int>(std::max(grid.rows, grid.cols));
+
+        for(int ring = 0; ring <= max_ring; ring++)
+        {
+            for(int r = row - ring; r <= row + ring; r++)
+            {
+                if(r < 0 || r >= (int)grid.rows)
+                {
+                    continue;
+                }
+
+                bool is_edge_row = r == row - ring || r == row + ring;
+
+                for(int c = col - ring; c <= col + ring; c += is_edge_row ? 1 : 2 * ring)
+                {
+                    if(c >= 0 && c < (int)grid.cols)
+                    {
+                        uint32_t cell = r * grid.cols + c;
+
+                        for(uint32_t i = data.grid_offsets[cell]; i < data.grid_offsets[cell + 1]; i++)
+                        {
+                            StopId stop = data.grid_stops[i];
+                            std::pair<StopId, double> candidate{stop, geo::ComputeDistance(point, GetStopCoordinates(stop))};
+
+                            if(result.size() < count)
+                            {
+                                result.push_back(candidate);
+                                std::push_heap(result.begin(), result.end(), closer);
+                            }
+                            else if(closer(candidate, result.front()))
+                            {
+                                std::pop_heap(result.begin(), result.end(), closer);
+                                result.back() = candidate;
+                                std::push_heap(result.begin(), result.end(), closer);
+                            }
+                        }
+                    }
+
+                    if(ring == 0)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            if(result.size() == count)
+            {
+                // distance from the point to the nearest border of the scanned square
+                double covered_lat = std::min(point.lat - (grid.min_lat + (row - ring) * grid.cell_lat),
+                                              grid.min_lat + (row + ring + 1) * grid.cell_lat - point.lat);
+                double covered_lng = std::min(point.lng - (grid.min_lng + (col - ring) * grid.cell_lng),
+                                              grid.min_lng + (col + ring + 1) * grid.cell_lng - point.lng);
+
+                double covered = std::min(covered_lat * detail::METERS_PER_DEGREE, covered_lng * detail::METERS_PER_DEGREE * min_cos);
+
+                if(result.front().second <= covered)
+                {
+                    break;
+                }
+            }
+        }
+
+        std::sort_heap(result.begin(), result.end(), closer);
+
         return result;
     }
 
-    std::vector<const Stop*>&& TransportCatalogue::GetStopsIndex() const
+    std::vector<std::pair<StopId, double>> TransportCatalogue::FindStopsInRadius(geo::Coordinates point, double radius) const
     {
-        static std::vector<const Stop*> stops;
+        const detail::CatalogueData& data = Data();
+        const detail::GridHeader& grid = data.grid[0];
 
-        for(const auto [name, stop] : stops_index_)
+        std::vector<std::pair<StopId, double>> result;
+
+        if(radius < 0 || data.grid_stops.empty())
         {
-            if(stop_to_routes_index_.count(stop))
+            return result;
+        }
+
+        double delta_lat = radius / detail::METERS_PER_DEGREE;
+        double max_abs_lat = std::min(std::max(std::abs(point.lat - delta_lat), std::abs(point.lat + delta_lat)), 89.);
+        double delta_lng = delta_lat / std::cos(max_abs_lat * detail::RADIANS_PER_DEGREE);
+
+        uint32_t row_begin = detail::GetCellIndex(point.lat - delta_lat, grid.min_lat, grid.cell_lat, grid.rows);
+        uint32_t row_end = detail::GetCellIndex(point.lat + delta_lat, grid.min_lat, grid.cell_lat, grid.rows);
+        uint32_t col_begin = detail::GetCellIndex(point.lng - delta_lng, grid.min_lng, grid.cell_lng, grid.cols);
+        uint32_t col_end = detail::GetCellIndex(point.lng + delta_lng, grid.min_lng, grid.cell_lng, grid.cols);
+
+        for(uint32_t r = row_begin; r <= row_end; r++)
+        {
+            for(uint32_t cell = r * grid.cols + col_begin; cell <= r * grid.cols + col_end; cell++)
             {
-                stops.push_back(stop);
+                for(uint32_t i = data.grid_offsets[cell]; i < data.grid_offsets[cell + 1]; i++)
+                {
+                    StopId stop = data.grid_stops[i];
+                    double distance = geo::ComputeDistance(point, GetStopCoordinates(stop));
+
+                    if(distance <= radius)
+                    {
+                        result.emplace_back(stop, distance);
+                    }
+                }
             }
         }
-        return std::move(stops);
+
+        std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs)
+        {
+            return lhs.second < rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+        });
+
+        return result;
+    }
+
+    std::optional<StopId> TransportCatalogue::FindStopId(std::string_view stop_name) const
+    {
+        if(!mapping_)
+        {
+            return stops_->names.Find(stop_name);
+        }
+        return detail::FindSorted(data_.stops_by_name, data_.stop_name_data, data_.stop_name_offsets, stop_name);
+    }
+
+    std::optional<BusId> TransportCatalogue::FindBusId(std::string_view bus_name) const
+    {
+        if(!mapping_)
+        {
+            return routes_->names.Find(bus_name);
+        }
+        return detail::FindSorted(data_.buses_by_name, data_.bus_name_data, data_.bus_name_offsets, bus_name);
+    }
+
+    Stop TransportCatalogue::GetStop(StopId id) const
+    {
+        return {id, GetStopName(id), GetStopCoordinates(id)};
+    }
+
+    std::string_view TransportCatalogue::GetStopName(StopId id) const
+    {
+        const detail::CatalogueData& data = Data();
+
+        return detail::GetName(data.stop_name_data, data.stop_name_offsets, id);
+    }
+
+    geo::Coordinates TransportCatalogue::GetStopCoordinates(StopId id) const
+    {
+        const detail::CatalogueData& data = Data();
+
+        return {data.stop_lats[id], data.stop_lngs[id]};
+    }
+
+    std::string_view TransportCatalogue::GetBusName(BusId id) const
+    {
+        const detail::CatalogueData& data = Data();
+
+        return detail::GetName(data.bus_name_data, data.bus_name_offsets, id);
+    }
+
+    Route TransportCatalogue::GetRoute(BusId id) const
+    {
+        const detail::CatalogueData& data = Data();
+
+        uint32_t begin = data.route_offsets[id];
+
+        return {Span<StopId>(data.route_stops.begin() + begin, data.route_offsets[id + 1] - begin), data.route_is_circular[id] != 0};
+    }
+
+    Span<StopId> TransportCatalogue::GetRouteStops(std::string_view route_name) const
+    {
+        auto bus_id = FindBusId(route_name);
+
+        if(bus_id)
+        {
+            return GetRoute(*bus_id).stops_;
+        }
+        return Span<StopId>();
+    }
+
+    std::optional<Span<BusId>> TransportCatalogue::GetStopRoutes(std::string_view stop_name) const
+    {
+        auto stop_id = FindStopId(stop_name);
+
+        if(!stop_id)
+        {
+            return std::nullopt;
+        }
+
+        const detail::CatalogueData& data = Data();
+
+        uint32_t begin = data.stop_to_routes_offsets[*stop_id];
+
+        return Span<BusId>(data.stop_to_routes.begin() + begin, data.stop_to_routes_offsets[*stop_id + 1] - begin);
+    }
+
+    int TransportCatalogue::GetDistance(StopId stop1, StopId stop2) const
+    {
+        const detail::CatalogueData& data = Data();
+
+        auto begin = data.distance_edges.begin() + data.distance_offsets[stop1];
+        auto end = data.distance_edges.begin() + data.distance_offsets[stop1 + 1];
+
+        auto it = std::lower_bound(begin, end, stop2, [](const detail::DistanceEdge& edge, StopId to)
+        {
+            return edge.to < to;
+        });
+
+        if(it != end && it->to == stop2)
+        {
+            return it->distance;
+        }
+        return 0;
     }
 
-    const std::unordered_map<std::string_view, Route*> TransportCatalogue::GetRouteIndex() const
+    std::optional<BusStats> TransportCatalogue::GetBusStats(std::string_view bus_name) const
     {
-        return routes_index;
+        auto bus_id = FindBusId(bus_name);
+
+        if(!bus_id)
+        {
+            return std::nullopt;
+        }
+
+        return Data().bus_stats[*bus_id];
+    }
+
+    size_t TransportCatalogue::GetStopCount() const
+    {
+        return Data().stop_lats.size();
+    }
+
+    size_t TransportCatalogue::GetBusCount() const
+    {
+        return Data().route_is_circular.size();
+    }
+
+    std::vector<std::string_view> TransportCatalogue::GetBuses() const
+    {
+        std::vector<std::string_view> result(GetBusCount());
+
+        for(BusId id = 0; id < result.size(); id++)
+        {
+            result[id] = GetBusName(id);
+        }
+        return result;
+    }
+
+    std::vector<Stop> TransportCatalogue::GetStopsIndex() const
+    {
+        const detail::CatalogueData& data = Data();
+
+        std::vector<Stop> stops;
+
+        for(StopId id = 0; id < data.stop_lats.size(); id++)
+        {
+            if(data.stop_to_routes_offsets[id] != data.stop_to_routes_offsets[id + 1])
+            {
+                stops.push_back(GetStop(id));
+            }
+        }
+        return stops;
     }
-}
\ No newline at end of file
+}
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <string>
-#include <deque>
-#include <unordered_set>
+#include <vector>
+#include <memory>
 #include <unordered_map>
 #include <optional>
 #include <string_view>
@@ -13,49 +13,269 @@ using namespace domain;
 
 namespace catalogue
 {
+    namespace detail
+    {
+        // append-only table of names packed into one buffer and addressed by dense id
+        class NameTable
+        {
+        public:
+            NameTable() = default;
+            NameTable(const NameTable& other);
+            NameTable(NameTable&&) = default;
+            NameTable& operator=(const NameTable& other);
+            NameTable& operator=(NameTable&&) = default;
+
+            uint32_t Add(std::string_view name);
+            std::optional<uint32_t> Find(std::string_view name) const;
+            std::string_view operator[](uint32_t id) const;
+            size_t size() const;
+            Span<char> GetData() const;
+            Span<uint32_t> GetOffsets() const;
+            void ShrinkToFit();
+
+        private:
+            void RebuildIndex();
+
+            std::vector<char> data_;
+            std::vector<uint32_t> offsets_{0};
+            std::unordered_map<std::string_view, uint32_t> index_;
+        };
+
+        struct DistanceEdge
+        {
+            StopId to;
+            int distance;
+        };
+
+        // uniform lat/lng grid over all stops; cell (row, col) is number row * cols + col
+        struct GridHeader
+        {
+            double min_lat;
+            double min_lng;
+            double cell_lat;
+            double cell_lng;
+            uint32_t rows;
+            uint32_t cols;
+        };
+
+        // Pointer-free layout of a built catalogue. Every array is either a view of the
+        // catalogue's own vectors or of a mapped snapshot file; queries only read through it.
+        struct CatalogueData
+        {
+            // names of stop i are stop_name_data[stop_name_offsets[i] .. stop_name_offsets[i + 1])
+            Span<char> stop_name_data;
+            Span<uint32_t> stop_name_offsets;
+            Span<StopId> stops_by_name;
+            Span<double> stop_lats;
+            Span<double> stop_lngs;
+
+            Span<char> bus_name_data;
+            Span<uint32_t> bus_name_offsets;
+            Span<BusId> buses_by_name;
+
+            // stops of bus i are route_stops[route_offsets[i] .. route_offsets[i + 1])
+            Span<uint32_t> route_offsets;
+            Span<StopId> route_stops;
+            Span<uint8_t> route_is_circular;
+
+            // buses of stop i, sorted by name
+            Span<uint32_t> stop_to_routes_offsets;
+            Span<BusId> stop_to_routes;
+
+            // directed road distances of stop i, sorted by target id, reverse-direction fallback included
+            Span<uint32_t> distance_offsets;
+            Span<DistanceEdge> distance_edges;
+
+            // indexed by BusId
+            Span<BusStats> bus_stats;
+
+            // one GridHeader; stops of cell i are grid_stops[grid_offsets[i] .. grid_offsets[i + 1])
+            Span<GridHeader> grid;
+            Span<uint32_t> grid_offsets;
+            Span<StopId> grid_stops;
+        };
+
+        // Parts a catalogue is stored in. A copy of a catalogue shares every part with the
+        // original; a table is copied before it is changed and an index is replaced when it
+        // is rebuilt, so a part that is shared is never written to
+        struct StopTable
+        {
+            NameTable names;
+            std::vector<double> lats;
+            std::vector<double> lngs;
+        };
+
+        struct RouteTable
+        {
+            NameTable names;
+            std::vector<uint32_t> offsets{0};
+            std::vector<StopId> stops;
+            std::vector<uint8_t> is_circular;
+        };
+
+        using DistanceMap = std::unordered_map<std::pair<StopId, StopId>, int, StopPairHash>;
+
+        struct StopIndex
+        {
+            std::vector<StopId> by_name;
+            GridHeader grid{0., 0., 1., 1., 1, 1};
+            std::vector<uint32_t> grid_offsets;
+            std::vector<StopId> grid_stops;
+        };
+
+        struct RouteIndex
+        {
+            std::vector<BusId> by_name;
+            std::vector<uint32_t> stop_to_routes_offsets;
+            std::vector<BusId> stop_to_routes;
+        };
+
+        struct DistanceTable
+        {
+            std::vector<uint32_t> offsets;
+            std::vector<DistanceEdge> edges;
+            // whether edges[i] was given for its own direction rather than the opposite one
+            std::vector<uint8_t> is_explicit;
+        };
+    }
+
+    // The catalogue is filled with AddStop/AddStopsDistances/AddRoute and then frozen.
+    // Freeze() builds every derived index and drops build-time structures; after that
+    // the catalogue is read-only and any number of threads may query it concurrently.
+    // Before freezing, derived indexes are rebuilt lazily on the first query after a change,
+    // each only if the change touched its input, and names, spans and routes handed out stay
+    // valid only until the next Add* call. Copies share storage until one of them is changed.
     class TransportCatalogue
     {
     public:
+
+        TransportCatalogue() = default;
+        TransportCatalogue(const TransportCatalogue&) = default;
+        TransportCatalogue(TransportCatalogue&&) = default;
+        TransportCatalogue& operator=(const TransportCatalogue&) = default;
+        TransportCatalogue& operator=(TransportCatalogue&&) = default;
         
-        Stop* AddStop(const std::string& name, const geo::Coordinates& coordinates);
+        StopId AddStop(std::string_view name, const geo::Coordinates& coordinates);
 
-        void AddStopsDistances(const std::string& name, const std::vector<std::pair<std::string, int>>& distances);
+        void AddStopsDistances(std::string_view name, const std::vector<std::pair<std::string, int>>& distances);
 
         void AddRoute(std::string&& route_name, std::vector<std::string>&& stop_names, bool is_circular);
 
-        const Stop* FindStopPtr(const std::string& stop_name) const;
+        // forms of the two above for stops already resolved to ids
+        void AddStopsDistances(StopId stop, const std::vector<std::pair<StopId, int>>& distances);
 
-        const std::vector<const Stop*> GetRouteStops(const std::string& route_name) const;
+        void AddRoute(std::string_view route_name, const std::vector<StopId>& stops, bool is_circular);
 
-        const std::optional<std::unordered_set<std::string*>> GetStopRoutes(const std::string& stop_name) const;
+        // takes the stop out of every existing route as if the route had been added without it:
+        // stops that become adjacent twice are merged, a two-way route still runs back and a
+        // closed round trip still ends where it starts. The stop itself stays in the catalogue
+        void CloseStop(std::string_view name);
 
-        int GetDistance(const Stop* stop1, const Stop* stop2) const;
+        // builds the indexes left stale by changes now rather than on the next query
+        void BuildIndexes() const;
 
-        std::vector<const Stop*>&& GetStopsIndex() const;
+        void Freeze();
+
+        bool IsFrozen() const;
+
+        // writes the frozen catalogue, indexes and bus stats included, as a binary snapshot
+        void SaveSnapshot(const std::string& path) const;
+
+        // maps a snapshot written by SaveSnapshot and serves queries straight from the mapping;
+        // the result is frozen. Throws std::runtime_error on a damaged or incompatible file
+        static TransportCatalogue LoadSnapshot(const std::string& path);
+
+        std::optional<StopId> FindStopId(std::string_view stop_name) const;
+
+        std::optional<BusId> FindBusId(std::string_view bus_name) const;
+
+        // ids run from 0 to count - 1
+        size_t GetStopCount() const;
+
+        size_t GetBusCount() const;
+
+        Stop GetStop(StopId id) const;
+
+        std::string_view GetStopName(StopId id) const;
+
+        geo::Coordinates GetStopCoordinates(StopId id) const;
+
+        std::string_view GetBusName(BusId id) const;
+
+        // empty for an unknown bus
+        Span<StopId> GetRouteStops(std::string_view route_name) const;
+
+        // buses passing through the stop, sorted by name; nullopt for an unknown stop
+        std::optional<Span<BusId>> GetStopRoutes(std::string_view stop_name) const;
+
+        int GetDistance(StopId stop1, StopId stop2) const;
+
+        // statistics of every bus are computed together with the other indexes
+        std::optional<BusStats> GetBusStats(std::string_view bus_name) const;
+
+        // up to count stops closest to the point, nearest first, with distances in meters
+        std::vector<std::pair<StopId, double>> FindNearestStops(geo::Coordinates point, size_t count) const;
+
+        // all stops within radius meters of the point, nearest first
+        std::vector<std::pair<StopId, double>> FindStopsInRadius(geo::Coordinates point, double radius) const;
+
+        std::vector<Stop> GetStopsIndex() const;
         
         std::vector<std::string_view> GetBuses() const;
 
         template<typename T>
         std::vector<std::string_view> GetBuses(T predicate) const;
 
-        const std::unordered_map<std::string_view, Route*> GetRouteIndex() const;
+        Route GetRoute(BusId id) const;
 
     private:
 
-        std::string* AddBus(const std::string&& name);
-        void UpdateStopIndex(const Stop* stop_ptr, std::string* route_name_ptr);
-        Route* MakeRoute(const std::vector<std::string>&& stop_names, bool is_circular);
+        // derived indexes, as bits of dirty_
+        enum Index : uint8_t
+        {
+            STOP_INDEX = 1,
+            ROUTE_INDEX = 2,
+            DISTANCE_TABLE = 4,
+            BUS_STATS = 8,
+            ALL_INDEXES = 15
+        };
+
+        const detail::CatalogueData& Data() const;
+        void CheckNotFrozen() const;
+        void Rebuild() const;
+        void BuildStopIndex() const;
+        void BuildRouteIndex() const;
+        void BuildDistanceTable() const;
+        void BuildBusStats() const;
+        void UpdateViews() const;
+
+        bool frozen_ = false;
+
+        // owner of the mapped file when the catalogue was loaded from a snapshot;
+        // the tables and indexes below are all empty in that case
+        std::shared_ptr<const void> mapping_;
+
+        // stop table, indexed by StopId; bus table, indexed by BusId
+        std::shared_ptr<detail::StopTable> stops_ = std::make_shared<detail::StopTable>();
+        std::shared_ptr<detail::RouteTable> routes_ = std::make_shared<detail::RouteTable>();
 
-        std::deque<Stop> stops;
-        std::deque<std::string> buses_;
-        std::deque<Route> routes_;
+        // distances given since the distance table was built, merged into it by the next rebuild;
+        // released by Freeze()
+        mutable std::shared_ptr<detail::DistanceMap> distances_ = std::make_shared<detail::DistanceMap>();
 
-        std::unordered_map<std::string_view, Stop*> stops_index_;
+        // derived indexes, rebuilt by Rebuild() on first use after a change to their input
+        mutable std::shared_ptr<const detail::StopIndex> stop_index_ = std::make_shared<detail::StopIndex>();
+        mutable std::shared_ptr<const detail::RouteIndex> route_index_ = std::make_shared<detail::RouteIndex>();
+        mutable std::shared_ptr<const detail::DistanceTable> distance_table_ = std::make_shared<detail::DistanceTable>();
+        mutable std::shared_ptr<const std::vector<BusStats>> bus_stats_ = std::make_shared<std::vector<BusStats>>();
 
-        std::unordered_map<std::string_view, Route*> routes_index;
-        std::unordered_map<const Stop*, std::unordered_set<std::string*>> stop_to_routes_index_; 
+        // buses whose stats are stale besides those added since the last rebuild: buses
+        // changed by CloseStop and buses through the stops whose distances were set
+        mutable std::vector<BusId> changed_buses_;
+        mutable std::vector<StopId> changed_stops_;
 
-        std::unordered_map<std::pair<const Stop*, const Stop*>, double, StopPairHash<Stop>> stop_distances_;
+        mutable detail::CatalogueData data_;
+        mutable uint8_t dirty_ = ALL_INDEXES;
     };
 
     template<typename T>
@@ -67,4 +287,4 @@ namespace catalogue
 
         return result;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,299 @@
+#include "transport_router.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace catalogue
+{
+    namespace routing
+    {
+        // meters per minute in one km/h
+        const double METERS_PER_MINUTE = 1000. / 60.;
+
+        std::vector<std::pair<BusId, Span<StopId>>> GetBusDirections(const TransportCatalogue& catalogue)
+        {
+            std::vector<std::pair<BusId, Span<StopId>>> result;
+
+            for(BusId bus = 0; bus < catalogue.GetBusCount(); bus++)
+            {
+                Route route = catalogue.GetRoute(bus);
+
+                if(route.is_circular_ || route.stops_.empty())
+                {
+                    result.emplace_back(bus, route.stops_);
+                    continue;
+                }
+
+                size_t middle = route.stops_.size() / 2;
+
+                result.emplace_back(bus, Span<StopId>(route.stops_.begin(), middle + 1));
+                result.emplace_back(bus, Span<StopId>(route.stops_.begin() + middle, route.stops_.size() - middle));
+            }
+
+            return result;
+        }
+
+        std::vector<StopId> FindComponents(const TransportCatalogue& catalogue)
+        {
+            // union-find over the stops of every bus, with path halving
+            std::vector<StopId> components(catalogue.GetStopCount());
+
+            for(StopId stop = 0; stop < components.size(); stop++)
+            {
+                components[stop] = stop;
+            }
+
+            auto find = [&components](StopId stop)
+            {
+                while(components[stop] != stop)
+                {
+                    components[stop] = components[components[stop]];
+                    stop = components[stop];
+                }
+                return stop;
+            };
+
+            for(BusId bus = 0; bus < catalogue.GetBusCount(); bus++)
+            {
+                Span<StopId> stops = catalogue.GetRoute(bus).stops_;
+
+                for(size_t i = 1; i < stops.size(); i++)
+                {
+                    components[find(stops[i])] = find(stops[0]);
+                }
+            }
+
+            for(StopId stop = 0; stop < components.size(); stop++)
+            {
+                components[stop] = find(stop);
+            }
+
+            return components;
+        }
+
+        TransportRouter::TransportRouter(const TransportCatalogue& catalogue, RoutingSettings settings) 
+            : catalogue_(catalogue), settings_(settings), router_(graph_)
+        {
+            if(!catalogue_.IsFrozen())
+            {
+                throw std::logic_error("routing needs a frozen catalogue");
+            }
+
+            if(settings_.bus_velocity <= 0 || settings_.bus_wait_time < 0)
+            {
+                throw std::invalid_argument("invalid routing settings");
+            }
+
+            stop_count_ = catalogue_.GetStopCount();
+            components_ = FindComponents(catalogue_);
+        }
+
+        void TransportRouter::BuildGraph() const
+        {
+            graph_ = graph::DirectedWeightedGraph<double>(stop_count_ * 2);
+
+            for(StopId stop = 0; stop < stop_count_; stop++)
+            {
+                graph_.AddEdge({ArrivalVertex(stop), BoardingVertex(stop), static_cast<double>(settings_.bus_wait_time)});
+            }
+
+            for(const auto& [bus, stops] : GetBusDirections(catalogue_))
+            {
+                AddBusEdges(bus, stops);
+            }
+
+            graph_.Build();
+        }
+
+        void TransportRouter::AddBusEdges(BusId bus, Span<StopId> stops) const
+        {
+            const double meters_per_minute = settings_.bus_velocity * METERS_PER_MINUTE;
+
+            for(size_t from = 0; from + 1 < stops.size(); from++)
+            {
+                int distance = 0;
+
+                for(size_t to = from + 1; to < stops.size(); to++)
+                {
+                    distance += catalogue_.GetDistance(stops[to - 1], stops[to]);
+
+                    if(stops[to] == stops[from])
+                    {
+                        continue;
+                    }
+
+                    graph_.AddEdge({BoardingVertex(stops[from]), ArrivalVertex(stops[to]), distance / meters_per_minute});
+                    bus_edges_.push_back({bus, static_cast<int>(to - from)});
+                }
+            }
+        }
+
+        std::optional<RouteResult> TransportRouter::BuildRoute(StopId from, StopId to) const
+        {
+            if(from != to && components_[from] != components_[to])
+            {
+                return std::nullopt;
+            }
+
+            if(hierarchy_)
+            {
+                auto route = hierarchy_->BuildRoute(ArrivalVertex(from), ArrivalVertex(to));
+                return route ? std::optional(MakeChainResult(*route)) : std::nullopt;
+            }
+
+            std::call_once(graph_once_, [this]()
+            {
+                BuildGraph();
+            });
+
+            auto route = router_.BuildRoute(ArrivalVertex(from), ArrivalVertex(to));
+            return route ? std::optional(MakeResult(*route)) : std::nullopt;
+        }
+
+        RouteResult TransportRouter::MakeResult(const graph::Router<double>::RouteInfo& route) const
+        {
+            RouteResult result{route.weight, {}};
+
+            result.items.reserve(route.edges.size());
+
+            for(graph::EdgeId edge_id : route.edges)
+            {
+                const double time = graph_.GetEdge(edge_id).weight;
+
+                if(edge_id < stop_count_)
+                {
+                    result.items.push_back({RouteItem::Type::WAIT, static_cast<StopId>(edge_id), 0, 0, time});
+                }
+                else
+                {
+                    const BusEdge& bus_edge = bus_edges_[edge_id - stop_count_];
+                    result.items.push_back({RouteItem::Type::BUS, 0, bus_edge.bus, bus_edge.span_count, time});
+                }
+            }
+
+            return result;
+        }
+
+        RouteResult TransportRouter::MakeChainResult(const graph::Router<double>::RouteInfo& route) const
+        {
+            RouteResult result{route.weight, {}};
+
+            // a bus leg runs from a boarding edge over ride edges to an alighting edge
+            for(graph::EdgeId edge_id : route.edges)
+            {
+                const double time = chain_graph_.GetEdge(edge_id).weight;
+
+                if(edge_id < stop_count_)
+                {
+                    result.items.push_back({RouteItem::Type::WAIT, static_cast<StopId>(edge_id), 0, 0, time});
+                    continue;
+                }
+
+                const ChainEdge& chain_edge = chain_edges_[edge_id - stop_count_];
+
+                if(chain_edge.type == ChainEdge::Type::BOARD)
+                {
+                    result.items.push_back({RouteItem::Type::BUS, 0, chain_edge.bus, 0, 0.});
+                }
+                else if(chain_edge.type == ChainEdge::Type::RIDE)
+                {
+                    result.items.back().span_count++;
+                    result.items.back().time += time;
+                }
+            }
+
+            return result;
+        }
+
+        const RoutingSettings& TransportRouter::GetSettings() const
+        {
+            return settings_;
+        }
+
+        void TransportRouter::BuildChainGraph()
+        {
+            if(chain_graph_.GetVertexCount() > 0)
+            {
+                return;
+            }
+
+            const double meters_per_minute = settings_.bus_velocity * METERS_PER_MINUTE;
+            const auto directions = GetBusDirections(catalogue_);
+
+            size_t vertex_count = stop_count_ * 2;
+
+            for(const auto& [bus, stops] : directions)
+            {
+                vertex_count += stops.size();
+            }
+
+            chain_graph_ = graph::DirectedWeightedGraph<double>(vertex_count);
+
+            for(StopId stop = 0; stop < stop_count_; stop++)
+            {
+                chain_graph_.AddEdge({ArrivalVertex(stop), BoardingVertex(stop), static_cast<double>(settings_.bus_wait_time)});
+            }
+
+            graph::VertexId ride = static_cast<graph::VertexId>(stop_count_ * 2);
+
+            for(const auto& [bus, stops] : directions)
+            {
+                for(size_t i = 0; i < stops.size(); i++, ride++)
+                {
+                    if(i + 1 < stops.size())
+                    {
+                        chain_graph_.AddEdge({BoardingVertex(stops[i]), ride, 0.});
+                        chain_edges_.push_back({bus, ChainEdge::Type::BOARD});
+
+                        chain_graph_.AddEdge({ride, ride + 1, catalogue_.GetDistance(stops[i], stops[i + 1]) / meters_per_minute});
+                        chain_edges_.push_back({bus, ChainEdge::Type::RIDE});
+                    }
+
+                    if(i > 0)
+                    {
+                        chain_graph_.AddEdge({ride, ArrivalVertex(stops[i]), 0.});
+                        chain_edges_.push_back({bus, ChainEdge::Type::ALIGHT});
+                    }
+                }
+            }
+
+            chain_graph_.Build();
+        }
+
+        void TransportRouter::BuildHierarchy()
+        {
+            BuildChainGraph();
+            hierarchy_ = graph::ContractionHierarchy::Build(chain_graph_);
+        }
+
+        void TransportRouter::SaveHierarchy(const std::string& path) const
+        {
+            if(!hierarchy_)
+            {
+                throw std::logic_error("no hierarchy to save");
+            }
+            hierarchy_->Save(path);
+        }
+
+        void TransportRouter::LoadHierarchy(const std::string& path)
+        {
+            BuildChainGraph();
+            hierarchy_ = graph::ContractionHierarchy::Load(path, chain_graph_);
+        }
+
+        bool TransportRouter::HasHierarchy() const
+        {
+            return hierarchy_.has_value();
+        }
+
+        graph::VertexId TransportRouter::ArrivalVertex(StopId stop)
+        {
+            return stop * 2;
+        }
+
+        graph::VertexId TransportRouter::BoardingVertex(StopId stop)
+        {
+            return stop * 2 + 1;
+        }
+    }
+}
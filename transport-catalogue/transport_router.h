@@ -0,0 +1,145 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "contraction_hierarchy.h"
+#include "graph.h"
+#include "router.h"
+#include "transport_catalogue.h"
+
+namespace catalogue
+{
+    namespace routing
+    {
+        struct RoutingSettings
+        {
+            // minutes spent waiting for any bus at a stop
+            int bus_wait_time = 0;
+            // km/h
+            double bus_velocity = 0.;
+        };
+
+        struct RouteItem
+        {
+            enum class Type
+            {
+                WAIT,
+                BUS
+            };
+
+            Type type;
+            // stop waited at, for WAIT
+            StopId stop;
+            // bus ridden and number of stops passed, for BUS
+            BusId bus;
+            int span_count;
+            // minutes
+            double time;
+        };
+
+        struct RouteResult
+        {
+            double total_time;
+            std::vector<RouteItem> items;
+        };
+
+        // each direction of every bus with the stops it passes in order; a two-way route is
+        // stored as there and back with the far end in the middle, and riding through the far
+        // end is not allowed, so each way is a direction of its own
+        std::vector<std::pair<BusId, Span<StopId>>> GetBusDirections(const TransportCatalogue& catalogue);
+
+        // stops joined by buses regardless of direction share a component, named by one of its
+        // stops; a search between components would only exhaust the source's one to find nothing
+        std::vector<StopId> FindComponents(const TransportCatalogue& catalogue);
+
+        // Every stop has two vertices, arrival and boarding, joined by a wait edge of
+        // bus_wait_time minutes. A bus adds an edge from the boarding vertex of each of its
+        // stops to the arrival vertex of every later stop in the same direction, weighted by
+        // the ride time along the road distances. The catalogue must be frozen and outlive
+        // the router; queries may run concurrently.
+        //
+        // Dijkstra over that graph is kept as the reference for the faster searches: Route
+        // requests are answered by RaptorRouter or by the hierarchy below, and
+        // tests/routing_test.cpp checks both against it. The graph grows with
+        // the square of route length, so it is built by the first query that runs Dijkstra and
+        // never for a router that only serves the hierarchy.
+        //
+        // A contraction hierarchy, if built, is made over another graph of the same routes: the
+        // edges of a bus direction form a chain of ride vertices, one per stop, with free edges
+        // from each stop's boarding vertex onto the chain and from the chain to its arrival
+        // vertex. That graph grows linearly with route length and contracts far better than
+        // the one above, which in turn is the faster one for plain Dijkstra
+        class TransportRouter
+        {
+        public:
+            TransportRouter(const TransportCatalogue& catalogue, RoutingSettings settings);
+
+            // nullopt when there is no way from one stop to the other
+            std::optional<RouteResult> BuildRoute(StopId from, StopId to) const;
+
+            const RoutingSettings& GetSettings() const;
+
+            // preprocesses the routes into a contraction hierarchy, which later queries search
+            // instead of running Dijkstra
+            void BuildHierarchy();
+
+            // throws std::logic_error if there is no hierarchy
+            void SaveHierarchy(const std::string& path) const;
+
+            // throws std::runtime_error if the file is damaged or was made for other data or settings
+            void LoadHierarchy(const std::string& path);
+
+            bool HasHierarchy() const;
+
+        private:
+            struct BusEdge
+            {
+                BusId bus;
+                int span_count;
+            };
+
+            struct ChainEdge
+            {
+                enum class Type : uint8_t
+                {
+                    BOARD,
+                    RIDE,
+                    ALIGHT
+                };
+
+                BusId bus;
+                Type type;
+            };
+
+            void BuildGraph() const;
+            void AddBusEdges(BusId bus, Span<StopId> stops) const;
+            void BuildChainGraph();
+
+            RouteResult MakeResult(const graph::Router<double>::RouteInfo& route) const;
+            RouteResult MakeChainResult(const graph::Router<double>::RouteInfo& route) const;
+
+            static graph::VertexId ArrivalVertex(StopId stop);
+            static graph::VertexId BoardingVertex(StopId stop);
+
+            const TransportCatalogue& catalogue_;
+            RoutingSettings settings_;
+            // built on the first Dijkstra query
+            mutable std::once_flag graph_once_;
+            mutable graph::DirectedWeightedGraph<double> graph_;
+            // edge i < stop count is the wait edge of stop i; bus edge i is bus_edges_[i - stop count]
+            mutable std::vector<BusEdge> bus_edges_;
+            size_t stop_count_ = 0;
+            // by stop, see FindComponents
+            std::vector<StopId> components_;
+            graph::Router<double> router_;
+
+            // wait edges come first as in graph_; built with the hierarchy
+            graph::DirectedWeightedGraph<double> chain_graph_;
+            std::vector<ChainEdge> chain_edges_;
+            std::optional<graph::ContractionHierarchy> hierarchy_;
+        };
+    }
+}